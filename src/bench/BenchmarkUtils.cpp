@@ -0,0 +1,56 @@
+#include "BenchmarkUtils.h"
+#include "version.h"
+
+#include <iostream>
+
+int BenchmarkUtils::getInt(const juce::ArgumentList& args, const juce::String& option, int fallback)
+{
+    return args.containsOption(option) ? args.getValueForOption(option).getIntValue() : fallback;
+}
+
+double BenchmarkUtils::getDouble(const juce::ArgumentList& args, const juce::String& option, double fallback)
+{
+    return args.containsOption(option) ? args.getValueForOption(option).getDoubleValue() : fallback;
+}
+
+juce::String BenchmarkUtils::getString(const juce::ArgumentList& args, const juce::String& option, const juce::String& fallback)
+{
+    return args.containsOption(option) ? args.getValueForOption(option) : fallback;
+}
+
+std::vector<int> BenchmarkUtils::getIntList(const juce::ArgumentList& args, const juce::String& option, std::vector<int> fallback)
+{
+    if (!args.containsOption(option))
+    {
+        return fallback;
+    }
+
+    std::vector<int> result;
+
+    for (auto& value : juce::StringArray::fromTokens(args.getValueForOption(option), ",", ""))
+    {
+        result.push_back(value.getIntValue());
+    }
+
+    return result;
+}
+
+int BenchmarkUtils::writeReport(const juce::ArgumentList& args, juce::DynamicObject::Ptr report)
+{
+    report->setProperty("version", version::get());
+
+    if (!args.containsOption("--out"))
+    {
+        return 0;
+    }
+
+    const auto outFile = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--out"));
+
+    if (!outFile.replaceWithText(juce::JSON::toString(juce::var(report.get()))))
+    {
+        std::cerr << "Failed to write " << outFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
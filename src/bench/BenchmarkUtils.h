@@ -0,0 +1,21 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <vector>
+
+// Command line parsing and result writing shared by the benchmark tools
+namespace BenchmarkUtils
+{
+    // The value of an option like --blocks 2000, or fallback if it is missing
+    int getInt(const juce::ArgumentList&, const juce::String& option, int fallback);
+    double getDouble(const juce::ArgumentList&, const juce::String& option, double fallback);
+    juce::String getString(const juce::ArgumentList&, const juce::String& option, const juce::String& fallback);
+
+    // The values of an option like --sizes 64,256, or fallback if it is missing
+    std::vector<int> getIntList(const juce::ArgumentList&, const juce::String& option, std::vector<int> fallback);
+
+    // Adds the plugin version to the report and writes it as JSON to the file
+    // given with --out, if any. Returns the exit code for main.
+    int writeReport(const juce::ArgumentList&, juce::DynamicObject::Ptr report);
+}
@@ -0,0 +1,195 @@
+// Times processBlock while 1 to 4 drum buses play a heavy kit, to show how
+// the render cost splits over the drum channels.
+//
+//   vmpc2000xl_DrumBenchmarks [--sample-rate 96000] [--block-size 512]
+//                             [--frames 441000] [--notes-per-beat 4]
+//                             [--blocks 2000] [--out results.json]
+//
+// Each drum bus gets its own sequencer track that keeps retriggering long
+// sounds, so voices pile up. The extra time per added bus is what that
+// drum channel costs. The parallel estimate is the time a block would take
+// if every drum channel rendered on its own core: the cost of the block
+// without drums plus the most expensive single drum channel.
+
+#include "PluginProcessor.h"
+#include "BenchmarkUtils.h"
+
+#include <sampler/Sampler.hpp>
+#include <sampler/Sound.hpp>
+#include <sampler/Program.hpp>
+#include <sampler/NoteParameters.hpp>
+#include <sequencer/Sequencer.hpp>
+#include <sequencer/Sequence.hpp>
+#include <sequencer/Track.hpp>
+#include <sequencer/NoteEvent.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+    constexpr int drumCount = 4;
+    constexpr int soundsPerDrum = 4;
+
+    struct Settings
+    {
+        double sampleRate;
+        int blockSize;
+        int frames;
+        int notesPerBeat;
+        int blocks;
+    };
+
+    void createKit(mpc::Mpc& mpc, int frames)
+    {
+        auto sampler = mpc.getSampler();
+        auto program = sampler->getProgram(0);
+
+        for (int i = 0; i < drumCount * soundsPerDrum; i++)
+        {
+            auto sound = sampler->addSound(44100);
+            sound->setName("DRUM" + std::to_string(i));
+            sound->setMono(false);
+
+            auto sampleData = sound->getSampleData();
+            sampleData->resize(static_cast<size_t>(frames) * 2);
+
+            const auto frequency = 40.0 + 15.0 * i;
+
+            for (int frame = 0; frame < frames; frame++)
+            {
+                const auto envelope = std::exp(-2.0 * frame / frames);
+                const auto value = static_cast<float>(envelope * std::sin(juce::MathConstants<double>::twoPi * frequency * frame / 44100.0));
+
+                (*sampleData)[static_cast<size_t>(frame)] = value;
+                (*sampleData)[static_cast<size_t>(frame + frames)] = value;
+            }
+
+            sound->setEnd(frames);
+            program->getNoteParameters(35 + i)->setSoundIndex(i);
+        }
+    }
+
+    // One track per drum bus, each playing its own four pads
+    void createSequence(mpc::Mpc& mpc, int activeDrums, int notesPerBeat)
+    {
+        constexpr int ticksPerBeat = 96;
+        constexpr int beats = 16;
+
+        auto sequence = mpc.getSequencer()->getSequence(0);
+        sequence->init(beats / 4 - 1);
+        sequence->setLoopEnabled(true);
+
+        for (int drum = 0; drum < activeDrums; drum++)
+        {
+            auto track = sequence->getTrack(drum);
+            track->setBusNumber(drum + 1);
+
+            for (int i = 0; i < beats * notesPerBeat; i++)
+            {
+                auto noteEvent = track->addNoteEvent(i * ticksPerBeat / notesPerBeat, 35 + drum * soundsPerDrum + i % soundsPerDrum);
+                noteEvent->setDuration(ticksPerBeat * 4);
+                noteEvent->setVelocity(100);
+            }
+        }
+    }
+
+    double timeBlocks(int activeDrums, const Settings& settings)
+    {
+        VmpcAudioProcessor processor;
+        createKit(processor.mpc, settings.frames);
+        createSequence(processor.mpc, activeDrums, settings.notesPerBeat);
+
+        processor.prepareToPlay(settings.sampleRate, settings.blockSize);
+        processor.mpc.getSequencer()->playFromStart();
+
+        juce::AudioBuffer<float> buffer(processor.getTotalNumOutputChannels(), settings.blockSize);
+        juce::MidiBuffer midiMessages;
+
+        // Let the voices pile up before measuring
+        for (int i = 0; i < settings.blocks / 4; i++)
+        {
+            processor.processBlock(buffer, midiMessages);
+        }
+
+        std::vector<double> timings;
+        timings.reserve(static_cast<size_t>(settings.blocks));
+
+        for (int i = 0; i < settings.blocks; i++)
+        {
+            midiMessages.clear();
+
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            processor.processBlock(buffer, midiMessages);
+            timings.push_back(juce::Time::getMillisecondCounterHiRes() - start);
+        }
+
+        processor.mpc.getSequencer()->stop();
+        processor.releaseResources();
+
+        std::sort(timings.begin(), timings.end());
+        return timings[timings.size() / 2];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    Settings settings;
+    settings.sampleRate = BenchmarkUtils::getDouble(args, "--sample-rate", 96000.0);
+    settings.blockSize = std::max(16, BenchmarkUtils::getInt(args, "--block-size", 512));
+    settings.frames = std::max(1, BenchmarkUtils::getInt(args, "--frames", 441000));
+    settings.notesPerBeat = std::max(1, BenchmarkUtils::getInt(args, "--notes-per-beat", 4));
+    settings.blocks = std::max(4, BenchmarkUtils::getInt(args, "--blocks", 2000));
+
+    const auto blockMs = settings.blockSize * 1000.0 / settings.sampleRate;
+
+    std::vector<double> timings;
+
+    for (int activeDrums = 0; activeDrums <= drumCount; activeDrums++)
+    {
+        timings.push_back(timeBlocks(activeDrums, settings));
+
+        std::cout << activeDrums << " drum bus(es): " << timings.back() << " ms per block, "
+                  << timings.back() / blockMs * 100.0 << " % of realtime" << std::endl;
+    }
+
+    juce::Array<juce::var> drums;
+    double maxDrumMs = 0.0;
+
+    for (int drum = 1; drum <= drumCount; drum++)
+    {
+        const auto drumMs = std::max(0.0, timings[static_cast<size_t>(drum)] - timings[static_cast<size_t>(drum - 1)]);
+        maxDrumMs = std::max(maxDrumMs, drumMs);
+
+        auto result = new juce::DynamicObject();
+        result->setProperty("activeDrums", drum);
+        result->setProperty("blockMs", timings[static_cast<size_t>(drum)]);
+        result->setProperty("addedMs", drumMs);
+        drums.add(juce::var(result));
+    }
+
+    const auto serialMs = timings.back();
+    const auto parallelMs = timings.front() + maxDrumMs;
+    const auto speedup = parallelMs > 0.0 ? serialMs / parallelMs : 1.0;
+
+    std::cout << "Without drums " << timings.front() << " ms, all drums " << serialMs << " ms, one core per drum at best "
+              << parallelMs << " ms (" << speedup << "x)" << std::endl;
+
+    juce::DynamicObject::Ptr report = new juce::DynamicObject();
+    report->setProperty("sampleRate", settings.sampleRate);
+    report->setProperty("blockSize", settings.blockSize);
+    report->setProperty("frames", settings.frames);
+    report->setProperty("notesPerBeat", settings.notesPerBeat);
+    report->setProperty("blocks", settings.blocks);
+    report->setProperty("noDrumsMs", timings.front());
+    report->setProperty("drums", drums);
+    report->setProperty("serialMs", serialMs);
+    report->setProperty("parallelEstimateMs", parallelMs);
+    report->setProperty("parallelSpeedup", speedup);
+
+    return BenchmarkUtils::writeReport(args, report);
+}
@@ -0,0 +1,116 @@
+// Times processBlock with dense MIDI input, with and without splitting the
+// block at the MIDI event timestamps.
+//
+//   vmpc2000xl_MidiBenchmarks [--block-sizes 64,256,1024,4096]
+//                             [--events 0,4,16,64] [--blocks 2000]
+//                             [--out results.json]
+//
+// Every combination of block size and note events per block is timed
+// twice, once with sampleAccurateMidi and once without. The difference is
+// the cost of the sub-block rendering.
+
+#include "PluginProcessor.h"
+#include "BenchmarkUtils.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+    // Spreads note on/off pairs evenly over the block, over all 64 pads
+    juce::MidiBuffer createBlockInput(int blockSize, int events)
+    {
+        juce::MidiBuffer midiMessages;
+
+        for (int i = 0; i < events; i++)
+        {
+            const auto note = 35 + i % 64;
+            const auto position = static_cast<int>(static_cast<int64_t>(i) * blockSize / events);
+            midiMessages.addEvent(juce::MidiMessage::noteOn(10, note, static_cast<juce::uint8>(100)), position);
+            midiMessages.addEvent(juce::MidiMessage::noteOff(10, note), std::min(blockSize - 1, position + blockSize / (2 * events) + 1));
+        }
+
+        return midiMessages;
+    }
+
+    double timeBlocks(VmpcAudioProcessor& processor, int blockSize, int events, int blocks)
+    {
+        juce::AudioBuffer<float> buffer(processor.getTotalNumOutputChannels(), blockSize);
+        const auto input = createBlockInput(blockSize, events);
+        juce::MidiBuffer midiMessages;
+
+        std::vector<double> timings;
+        timings.reserve(static_cast<size_t>(blocks));
+
+        for (int i = 0; i < blocks; i++)
+        {
+            buffer.clear();
+            midiMessages = input;
+
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            processor.processBlock(buffer, midiMessages);
+            timings.push_back(juce::Time::getMillisecondCounterHiRes() - start);
+        }
+
+        std::sort(timings.begin(), timings.end());
+        return timings[timings.size() / 2];
+    }
+
+    juce::var runBenchmark(int blockSize, int events, int blocks)
+    {
+        VmpcAudioProcessor processor;
+        processor.prepareToPlay(44100.0, blockSize);
+
+        processor.sampleAccurateMidi = false;
+        const auto wholeBlockMs = timeBlocks(processor, blockSize, events, blocks);
+
+        processor.sampleAccurateMidi = true;
+        const auto subBlockMs = timeBlocks(processor, blockSize, events, blocks);
+
+        processor.releaseResources();
+
+        const auto overhead = wholeBlockMs > 0.0 ? (subBlockMs - wholeBlockMs) / wholeBlockMs * 100.0 : 0.0;
+        const auto maxSubBlocks = std::min(2 * events + 1, blockSize / VmpcAudioProcessor::minimumSubBlockSize + 1);
+
+        auto result = new juce::DynamicObject();
+        result->setProperty("blockSize", blockSize);
+        result->setProperty("events", events);
+        result->setProperty("maxSubBlocks", maxSubBlocks);
+        result->setProperty("wholeBlockMs", wholeBlockMs);
+        result->setProperty("subBlockMs", subBlockMs);
+        result->setProperty("overheadPercent", overhead);
+
+        std::cout << blockSize << " samples, " << events << " notes: whole block " << wholeBlockMs
+                  << " ms, split " << subBlockMs << " ms (at most " << maxSubBlocks << " sub-blocks), overhead "
+                  << overhead << " %" << std::endl;
+
+        return juce::var(result);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    const auto blockSizes = BenchmarkUtils::getIntList(args, "--block-sizes", { 64, 256, 1024, 4096 });
+    const auto eventCounts = BenchmarkUtils::getIntList(args, "--events", { 0, 4, 16, 64 });
+    const auto blocks = std::max(1, BenchmarkUtils::getInt(args, "--blocks", 2000));
+
+    juce::Array<juce::var> results;
+
+    for (auto blockSize : blockSizes)
+    {
+        for (auto events : eventCounts)
+        {
+            results.add(runBenchmark(blockSize, events, blocks));
+        }
+    }
+
+    juce::DynamicObject::Ptr report = new juce::DynamicObject();
+    report->setProperty("minimumSubBlockSize", VmpcAudioProcessor::minimumSubBlockSize);
+    report->setProperty("blocks", blocks);
+    report->setProperty("results", results);
+
+    return BenchmarkUtils::writeReport(args, report);
+}
@@ -0,0 +1,317 @@
+// Times saving and restoring the plugin state of synthetic projects.
+//
+//   vmpc2000xl_Benchmarks [--sounds 8,64] [--frames 44100,441000]
+//                         [--events 0,20000] [--iterations 5]
+//                         [--compression none|fast|small] [--out results.json]
+//
+// Every combination of sound count, sample length (frames per stereo sound)
+// and note event count is a separate project. Results go to stdout and, with
+// --out, to a JSON file that can be diffed between commits.
+//
+// Every project runs in a child process, started with --project
+// SOUNDS,FRAMES,EVENTS, so its peak RSS isn't that of an earlier, larger
+// project. Every timed save is of a new processor, so it measures a full
+// save rather than one that reuses the payloads of the previous save.
+
+#include "PluginProcessor.h"
+#include "BenchmarkUtils.h"
+
+#include <sampler/Sampler.hpp>
+#include <sampler/Sound.hpp>
+#include <sequencer/Sequencer.hpp>
+#include <sequencer/Sequence.hpp>
+#include <sequencer/Track.hpp>
+#include <sequencer/NoteEvent.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    struct ProjectSize
+    {
+        int sounds;
+        int frames;
+        int events;
+    };
+
+    double getPeakRssMegabytes()
+    {
+#if JUCE_WINDOWS
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        {
+            return static_cast<double>(counters.PeakWorkingSetSize) / (1024.0 * 1024.0);
+        }
+
+        return 0.0;
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#if JUCE_MAC
+        // Bytes on macOS, kilobytes elsewhere
+        return static_cast<double>(usage.ru_maxrss) / (1024.0 * 1024.0);
+#else
+        return static_cast<double>(usage.ru_maxrss) / 1024.0;
+#endif
+#endif
+    }
+
+    void createProject(mpc::Mpc& mpc, const ProjectSize& size)
+    {
+        auto sampler = mpc.getSampler();
+        juce::Random random(size.sounds * 31 + size.frames);
+
+        for (int i = 0; i < size.sounds; i++)
+        {
+            auto sound = sampler->addSound(44100);
+            sound->setName("BENCH" + std::to_string(i));
+            sound->setMono(false);
+
+            // A decaying tone with some noise, so the state compression sees
+            // something that resembles a drum hit rather than silence.
+            auto sampleData = sound->getSampleData();
+            sampleData->resize(static_cast<size_t>(size.frames) * 2);
+
+            const auto frequency = 50.0 + 20.0 * i;
+
+            for (int frame = 0; frame < size.frames; frame++)
+            {
+                const auto envelope = std::exp(-4.0 * frame / size.frames);
+                const auto tone = std::sin(juce::MathConstants<double>::twoPi * frequency * frame / 44100.0);
+                const auto value = static_cast<float>(envelope * (0.8 * tone + 0.05 * (random.nextDouble() - 0.5)));
+
+                (*sampleData)[static_cast<size_t>(frame)] = value;
+                (*sampleData)[static_cast<size_t>(frame + size.frames)] = value;
+            }
+
+            sound->setEnd(size.frames);
+        }
+
+        if (size.events == 0)
+        {
+            return;
+        }
+
+        constexpr int ticksPerBar = 384;
+        const auto barCount = std::clamp(size.events / 256, 1, 999);
+
+        auto sequence = mpc.getSequencer()->getSequence(0);
+        sequence->init(barCount - 1);
+
+        for (int i = 0; i < size.events; i++)
+        {
+            auto track = sequence->getTrack(i % 64);
+            const auto tick = static_cast<int>((static_cast<int64_t>(i) * 7919) % (barCount * ticksPerBar));
+
+            auto noteEvent = track->addNoteEvent(tick, 35 + i % 64);
+            noteEvent->setDuration(24);
+            noteEvent->setVelocity(1 + i % 127);
+        }
+    }
+
+    template <typename Function>
+    double medianMilliseconds(int iterations, Function&& function)
+    {
+        std::vector<double> timings;
+
+        for (int i = 0; i < iterations; i++)
+        {
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            function();
+            timings.push_back(juce::Time::getMillisecondCounterHiRes() - start);
+        }
+
+        std::sort(timings.begin(), timings.end());
+        return timings[timings.size() / 2];
+    }
+
+    juce::var createTiming(double milliseconds, size_t bytes)
+    {
+        auto timing = new juce::DynamicObject();
+        timing->setProperty("ms", milliseconds);
+        timing->setProperty("mbPerSecond", milliseconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / (milliseconds / 1000.0) : 0.0);
+        return juce::var(timing);
+    }
+
+    juce::var runBenchmark(const ProjectSize& size, int iterations, SampleCodec::Level compression)
+    {
+        juce::MemoryBlock state;
+        std::vector<double> saveTimings;
+        double cachedSaveMs = 0.0;
+
+        for (int i = 0; i < iterations; i++)
+        {
+            VmpcAudioProcessor processor;
+            processor.setStateCompression(compression);
+            createProject(processor.mpc, size);
+
+            const auto start = juce::Time::getMillisecondCounterHiRes();
+            processor.getStateInformation(state);
+            saveTimings.push_back(juce::Time::getMillisecondCounterHiRes() - start);
+
+            if (i == iterations - 1)
+            {
+                cachedSaveMs = medianMilliseconds(iterations, [&] {
+                    processor.getStateInformation(state);
+                });
+            }
+        }
+
+        std::sort(saveTimings.begin(), saveTimings.end());
+        const auto saveMs = saveTimings[saveTimings.size() / 2];
+
+        const auto peakAfterSave = getPeakRssMegabytes();
+
+        double restoreMs, lazyRestoreMs;
+
+        {
+            VmpcAudioProcessor processor;
+
+            processor.soundRestoreMode = VmpcAudioProcessor::SoundRestoreMode::Eager;
+            restoreMs = medianMilliseconds(iterations, [&] {
+                processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+            });
+
+            // Time until the project is usable, the sample data keeps
+            // streaming in afterwards.
+            processor.soundRestoreMode = VmpcAudioProcessor::SoundRestoreMode::Lazy;
+            lazyRestoreMs = medianMilliseconds(iterations, [&] {
+                processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+            });
+        }
+
+        const auto sampleBytes = static_cast<size_t>(size.sounds) * static_cast<size_t>(size.frames) * 2 * sizeof(int16_t);
+
+        auto result = new juce::DynamicObject();
+        result->setProperty("sounds", size.sounds);
+        result->setProperty("frames", size.frames);
+        result->setProperty("events", size.events);
+        result->setProperty("sampleBytes", static_cast<juce::int64>(sampleBytes));
+        result->setProperty("stateBytes", static_cast<juce::int64>(state.getSize()));
+        result->setProperty("save", createTiming(saveMs, state.getSize()));
+        result->setProperty("cachedSave", createTiming(cachedSaveMs, state.getSize()));
+        result->setProperty("restore", createTiming(restoreMs, state.getSize()));
+        result->setProperty("lazyRestore", createTiming(lazyRestoreMs, state.getSize()));
+        result->setProperty("peakRssMBAfterSave", peakAfterSave);
+        result->setProperty("peakRssMB", getPeakRssMegabytes());
+        return juce::var(result);
+    }
+
+    // Runs one project in a child process, which prints its result as the
+    // last line of its output.
+    juce::var runChild(const ProjectSize& size, int iterations, const juce::String& compressionName)
+    {
+        juce::StringArray command;
+        command.add(juce::File::getSpecialLocation(juce::File::currentExecutableFile).getFullPathName());
+        command.add("--project");
+        command.add(juce::String(size.sounds) + "," + juce::String(size.frames) + "," + juce::String(size.events));
+        command.add("--iterations");
+        command.add(juce::String(iterations));
+        command.add("--compression");
+        command.add(compressionName);
+
+        juce::ChildProcess child;
+
+        if (!child.start(command, juce::ChildProcess::wantStdOut))
+        {
+            return {};
+        }
+
+        const auto output = child.readAllProcessOutput();
+
+        if (!child.waitForProcessToFinish(-1) || child.getExitCode() != 0)
+        {
+            return {};
+        }
+
+        return juce::JSON::parse(juce::StringArray::fromLines(output.trim()).strings.getLast());
+    }
+
+    double getTimingMs(const juce::var& result, const char* name)
+    {
+        return result[name]["ms"];
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    const auto soundCounts = BenchmarkUtils::getIntList(args, "--sounds", { 8, 64 });
+    const auto frameCounts = BenchmarkUtils::getIntList(args, "--frames", { 44100, 441000 });
+    const auto eventCounts = BenchmarkUtils::getIntList(args, "--events", { 0, 20000 });
+    const auto iterations = std::max(1, BenchmarkUtils::getInt(args, "--iterations", 5));
+
+    const auto compressionName = BenchmarkUtils::getString(args, "--compression", "fast");
+    auto compression = SampleCodec::Level::Fast;
+
+    if (compressionName == "none")
+    {
+        compression = SampleCodec::Level::None;
+    }
+    else if (compressionName == "small")
+    {
+        compression = SampleCodec::Level::Small;
+    }
+
+    if (args.containsOption("--project"))
+    {
+        const auto project = BenchmarkUtils::getIntList(args, "--project", {});
+
+        if (project.size() != 3)
+        {
+            std::cerr << "--project expects SOUNDS,FRAMES,EVENTS" << std::endl;
+            return 1;
+        }
+
+        const auto result = runBenchmark({ project[0], project[1], project[2] }, iterations, compression);
+        std::cout << juce::JSON::toString(result, true) << std::endl;
+        return 0;
+    }
+
+    juce::Array<juce::var> results;
+
+    for (auto sounds : soundCounts)
+    {
+        for (auto frames : frameCounts)
+        {
+            for (auto events : eventCounts)
+            {
+                const auto result = runChild({ sounds, frames, events }, iterations, compressionName);
+
+                if (!result.isObject())
+                {
+                    std::cerr << sounds << " sounds x " << frames << " frames, " << events << " events: failed" << std::endl;
+                    return 1;
+                }
+
+                std::cout << sounds << " sounds x " << frames << " frames, " << events << " events: "
+                          << static_cast<juce::int64>(result["stateBytes"]) / 1024 << " KB, save " << getTimingMs(result, "save")
+                          << " ms, cached save " << getTimingMs(result, "cachedSave")
+                          << " ms, restore " << getTimingMs(result, "restore")
+                          << " ms, lazy restore " << getTimingMs(result, "lazyRestore")
+                          << " ms, peak RSS " << static_cast<double>(result["peakRssMB"]) << " MB" << std::endl;
+
+                results.add(result);
+            }
+        }
+    }
+
+    juce::DynamicObject::Ptr report = new juce::DynamicObject();
+    report->setProperty("compression", compressionName);
+    report->setProperty("iterations", iterations);
+    report->setProperty("results", results);
+
+    return BenchmarkUtils::writeReport(args, report);
+}
@@ -3,6 +3,7 @@
 #include "PluginProcessor.h"
 
 #include "ResourceUtil.h"
+#include "gui/PluginSettingsMenu.h"
 
 #include <hardware/Hardware.hpp>
 #include <audiomidi/AudioMidiServices.hpp>
@@ -11,7 +12,13 @@
 VmpcAudioProcessorEditor::VmpcAudioProcessorEditor(VmpcAudioProcessor& p)
 : AudioProcessorEditor(&p), vmpcAudioProcessor(p), mpc(p.mpc)
 {
+  if (!juce::JUCEApplication::isStandaloneApp())
+  {
+    p.showAudioSettingsDialog = [this]() { PluginSettingsMenu::show(vmpcAudioProcessor, *this); };
+  }
+
   auto content = new ContentComponent(mpc, p.showAudioSettingsDialog);
+  content->onUserInteraction = [&p]() { p.markStateDirty(); };
   
   const bool deleteContentWhenNotUsedAnymore = true;
   viewport.setViewedComponent(content, deleteContentWhenNotUsedAnymore);
@@ -36,6 +43,11 @@ VmpcAudioProcessorEditor::VmpcAudioProcessorEditor(VmpcAudioProcessor& p)
 
 VmpcAudioProcessorEditor::~VmpcAudioProcessorEditor()
 {
+  if (!juce::JUCEApplication::isStandaloneApp())
+  {
+    vmpcAudioProcessor.showAudioSettingsDialog = [](){};
+  }
+
   vmpcSplashScreen.deleteAndZero();
 }
 
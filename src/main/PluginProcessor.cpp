@@ -4,8 +4,16 @@
 
 #include "gui/VmpcLookAndFeel.h"
 #include "lcdgui/screens/VmpcSettingsScreen.hpp"
+#include "lcdgui/screens/VmpcAutoSaveScreen.hpp"
 #include "AutoSave.hpp"
 
+#include "state/StateChunks.h"
+#include "state/StateCache.h"
+#include "state/SoundChunks.h"
+#include "state/LazySoundLoader.h"
+#include "state/StateSnapshot.h"
+#include "state/AutosaveJournal.h"
+
 #include <audiomidi/AudioMidiServices.hpp>
 #include <audiomidi/DiskRecorder.hpp>
 #include <audiomidi/SoundRecorder.hpp>
@@ -15,13 +23,12 @@
 
 #include <file/aps/ApsParser.hpp>
 #include <file/all/AllParser.hpp>
-#include <file/sndwriter/SndWriter.hpp>
-#include <file/sndreader/SndReader.hpp>
 #include <disk/ApsLoader.hpp>
 #include <disk/AllLoader.hpp>
 #include <disk/AbstractDisk.hpp>
 
 #include <Paths.hpp>
+#include <sampler/Sampler.hpp>
 #include <sequencer/Sequencer.hpp>
 
 #include <lcdgui/screens/SyncScreen.hpp>
@@ -40,8 +47,6 @@ using namespace mpc::lcdgui::screens;
 using namespace mpc::lcdgui::screens::window;
 using namespace mpc::file::aps;
 using namespace mpc::file::all;
-using namespace mpc::file::sndwriter;
-using namespace mpc::file::sndreader;
 using namespace mpc::disk;
 
 using namespace ctoot::midi::core;
@@ -61,11 +66,22 @@ VmpcAudioProcessor::VmpcAudioProcessor()
                   .withOutput("MIX OUT 3/4", juce::AudioChannelSet::stereo(), false)
                   .withOutput("MIX OUT 5/6", juce::AudioChannelSet::stereo(), false)
                   .withOutput("MIX OUT 7/8", juce::AudioChannelSet::stereo(), false)
-                  )
+                  ),
+  lazySoundLoader(getCallbackLock()),
+  sampleFileIndex(juce::File(mpc::Paths::storesPath()))
 {
     lookAndFeel = new VmpcLookAndFeel();
     juce::LookAndFeel::setDefaultLookAndFeel(lookAndFeel);
 
+    midiInputMessage = std::make_unique<ShortMessage>();
+
+    lazySoundLoader.onSampleDataMissing = [](std::vector<std::string> soundNames) {
+        reportMissingSampleData(soundNames);
+    };
+
+    // States saved before the files were found embed their sample data
+    sampleFileIndex.onFilesFound = [this] { markStateDirty(); };
+
     time_t currentTime = time(nullptr);
   struct tm* currentLocalTime = localtime(&currentTime);
   auto timeString = std::string(asctime(currentLocalTime));
@@ -82,14 +98,19 @@ VmpcAudioProcessor::VmpcAudioProcessor()
 
   if (juce::JUCEApplication::isStandaloneApp())
   {
-    mpc::AutoSave::restoreAutoSavedState(mpc);
+    startStandaloneSession();
   }
+
+  // What saves fall back on while the sequencer records, see captureProject
+  StateSnapshot initialProject;
+  captureProject(initialProject);
 }
 
 VmpcAudioProcessor::~VmpcAudioProcessor()
 {
     if (juce::JUCEApplication::isStandaloneApp())
     {
+        stateAutosaver.reset();
         mpc::AutoSave::storeAutoSavedState(mpc);
     }
 
@@ -199,8 +220,46 @@ void VmpcAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 
   monoToStereoBufferIn.clear();
   monoToStereoBufferIn.setSize(2, samplesPerBlock);
-  monoToStereoBufferOut.clear();
-  monoToStereoBufferOut.setSize(2, samplesPerBlock);
+  unusedOutputBuffer.setSize(2, samplesPerBlock);
+  unusedOutputBuffer.clear();
+
+  // Some hosts switch to offline rendering before preparing
+  if (isNonRealtime())
+  {
+    finishLoadingSounds();
+  }
+}
+
+void VmpcAudioProcessor::setNonRealtime(bool isNonRealtime) noexcept
+{
+  AudioProcessor::setNonRealtime(isNonRealtime);
+
+  // Some wrappers call this from their process callback, so it must not
+  // wait for the sample data that is still streaming in. The first
+  // offline block waits for whatever is left.
+  if (isNonRealtime)
+  {
+    try
+    {
+      lazySoundLoader.startFinishing();
+    }
+    catch (const std::exception& e)
+    {
+      moduru::Logger::l.log("Failed to load sample data in the background: " + std::string(e.what()) + "\n");
+    }
+  }
+}
+
+void VmpcAudioProcessor::finishLoadingSounds()
+{
+  try
+  {
+    lazySoundLoader.finish();
+  }
+  catch (const std::exception& e)
+  {
+    moduru::Logger::l.log("Failed to load sample data: " + std::string(e.what()) + "\n");
+  }
 }
 
 void VmpcAudioProcessor::releaseResources()
@@ -214,110 +273,224 @@ bool VmpcAudioProcessor::isBusesLayoutSupported (const BusesLayout&) const
   return true;
 }
 
-void VmpcAudioProcessor::processMidiIn(juce::MidiBuffer& midiMessages) {
+void VmpcAudioProcessor::processMidiIn(const MidiEventBatch::Event* begin, const MidiEventBatch::Event* end, int sampleOffset) {
+
+  // One pass over the events, reusing one preallocated ShortMessage
+  auto midiInput = mpc.getMpcMidiInput(0);
 
-  for (const auto& meta : midiMessages)
+  for (auto it = begin; it != end; ++it)
   {
-    const auto& m = meta.getMessage();
-    int timeStamp = static_cast<int>(m.getTimeStamp());
-    int velocity = m.getVelocity();
-    std::shared_ptr<ShortMessage> tootMsg;
+    auto& event = *it;
 
-    if (m.isNoteOn())
-    {
-      tootMsg = std::make_shared<ShortMessage>();
-      tootMsg->setMessage(ShortMessage::NOTE_ON, m.getChannel() - 1, m.getNoteNumber(), velocity);
-    }
-    else if (m.isNoteOff())
+    if (event.status == MidiEventBatch::machineControl)
     {
-        tootMsg = std::make_shared<ShortMessage>();
-        tootMsg->setMessage(ShortMessage::NOTE_OFF, m.getChannel() - 1, m.getNoteNumber(), 0);
+      processMachineControl(event.data1);
+      continue;
     }
-    else if (m.isController())
+
+    const int command = event.status & 0xF0;
+    const int channel = event.status & 0x0F;
+
+    switch (command)
     {
-        tootMsg = std::make_shared<ShortMessage>();
-        tootMsg->setMessage(ShortMessage::CONTROL_CHANGE, m.getChannel() - 1, m.getControllerNumber(), m.getControllerValue());
+      case ShortMessage::NOTE_ON:
+        if (event.data2 == 0)
+        {
+          midiInputMessage->setMessage(ShortMessage::NOTE_OFF, channel, event.data1, 0);
+        }
+        else
+        {
+          midiInputMessage->setMessage(ShortMessage::NOTE_ON, channel, event.data1, event.data2);
+        }
+        break;
+      case ShortMessage::NOTE_OFF:
+        midiInputMessage->setMessage(ShortMessage::NOTE_OFF, channel, event.data1, 0);
+        break;
+      case ShortMessage::CONTROL_CHANGE:
+      case ShortMessage::POLY_PRESSURE:
+      case ShortMessage::PITCH_BEND:
+        midiInputMessage->setMessage(command, channel, event.data1, event.data2);
+        break;
+      case ShortMessage::CHANNEL_PRESSURE:
+      case ShortMessage::PROGRAM_CHANGE:
+        midiInputMessage->setMessage(command, channel, event.data1, 0);
+        break;
+      default:
+        continue;
     }
-    else if (m.isAftertouch())
+
+    midiInput->transport(midiInputMessage.get(), std::max(0, event.timestamp - sampleOffset));
+  }
+}
+
+void VmpcAudioProcessor::processMachineControl(int command)
+{
+  // The engine has no use for SysEx apart from these MIDI Machine Control
+  // commands.
+  auto sequencer = mpc.getSequencer();
+
+  switch (command)
+  {
+    case 0x01: // Stop
+    case 0x09: // Pause
+      if (sequencer->isPlaying())
+      {
+        sequencer->stop();
+      }
+      break;
+    case 0x02: // Play
+    case 0x03: // Deferred play
+      if (!sequencer->isPlaying())
+      {
+        sequencer->play();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void VmpcAudioProcessor::processMidiOut(int sampleOffset)
+{
+    auto midiOutput = mpc.getMidiOutput();
+
+    const auto outputAEventCount = midiOutput->dequeueOutputA(midiOutputBuffer);
+
+    for (unsigned int i = 0; i < outputAEventCount; i++)
     {
-        tootMsg = std::make_shared<ShortMessage>();
-        tootMsg->setMessage(ShortMessage::POLY_PRESSURE, m.getChannel() - 1, m.getNoteNumber(), m.getAfterTouchValue());
+        addMidiOutMessage(midiOutputAQueue, *midiOutputBuffer[i], sampleOffset, false);
     }
-    else if (m.isChannelPressure())
+
+    // Port B is always drained, so it doesn't back up while it goes nowhere
+    const auto outputBEventCount = midiOutput->dequeueOutputB(midiOutputBuffer);
+
+    if (midiOutputB.hasOutput())
     {
-        tootMsg = std::make_shared<ShortMessage>();
-        tootMsg->setMessage(ShortMessage::CHANNEL_PRESSURE, m.getChannel() - 1, m.getChannelPressureValue(), 0);
+        for (unsigned int i = 0; i < outputBEventCount; i++)
+        {
+            addMidiOutMessage(midiOutputBQueue, *midiOutputBuffer[i], sampleOffset, false);
+        }
     }
-
-    if (tootMsg)
+    else if (getMidiOutBMode() != MidiOutBMode::Off)
     {
-        mpc.getMpcMidiInput(0)->transport(tootMsg.get(), timeStamp);
+        for (unsigned int i = 0; i < outputBEventCount; i++)
+        {
+            addMidiOutMessage(midiOutputAQueue, *midiOutputBuffer[i], sampleOffset, true);
+        }
     }
-  }
 }
 
-void VmpcAudioProcessor::processMidiOut(juce::MidiBuffer& midiMessages)
+void VmpcAudioProcessor::addMidiOutMessage(MidiOutputQueue& queue, const ShortMessage& msg, int sampleOffset, bool mergePortB)
 {
-    midiMessages.clear();
+    juce::uint8 bytes[3];
+    int numBytes = 0;
 
-    static auto processMsg = [&midiMessages](std::shared_ptr<ShortMessage>& msg) {
-        juce::MidiMessage juceMsg;
-        bool compatibleMsg = false;
+    const auto status = msg.getStatus();
+    const auto mode = mergePortB ? getMidiOutBMode() : MidiOutBMode::Off;
 
-        if (msg->getStatus() == ShortMessage::NOTE_ON || msg->getStatus() == ShortMessage::NOTE_OFF)
-        {
-            juce::uint8 velo = (juce::uint8) msg->getData2();
+    if (status == ShortMessage::NOTE_ON || status == ShortMessage::NOTE_OFF)
+    {
+        auto channel = msg.getChannel();
 
-            juceMsg = velo == 0 ? juce::MidiMessage::noteOff(msg->getChannel() + 1, msg->getData1())
-                                                  : juce::MidiMessage::noteOn(msg->getChannel() + 1, msg->getData1(),
-                                                                              juce::uint8(velo));
-            compatibleMsg = true;
-        }
-        else if (msg->getStatus() == ShortMessage::TIMING_CLOCK)
-        {
-            juceMsg = juce::MidiMessage::midiClock();
-            compatibleMsg = true;
-        }
-        else if (msg->getStatus() == ShortMessage::START)
+        if (mode == MidiOutBMode::ChannelOffset)
         {
-            juceMsg = juce::MidiMessage::midiStart();
-            compatibleMsg = true;
+            channel += getMidiOutBChannelOffset();
+
+            // Past channel 16 it would land on a port A channel
+            if (channel > 15)
+            {
+                return;
+            }
         }
-        else if (msg->getStatus() == ShortMessage::STOP)
+
+        const auto velocity = msg.getData2();
+        bytes[0] = static_cast<juce::uint8>((velocity == 0 ? 0x80 : 0x90) | (channel & 0x0F));
+        bytes[1] = static_cast<juce::uint8>(msg.getData1() & 0x7F);
+        bytes[2] = static_cast<juce::uint8>(velocity & 0x7F);
+        numBytes = 3;
+    }
+    else if (status == ShortMessage::TIMING_CLOCK || status == ShortMessage::START ||
+             status == ShortMessage::STOP || status == ShortMessage::CONTINUE)
+    {
+        // Port A already carries the clock of a channel offset port B
+        if (mode == MidiOutBMode::ChannelOffset)
         {
-            juceMsg = juce::MidiMessage::midiStop();
-            compatibleMsg = true;
+            return;
         }
-        else if (msg->getStatus() == ShortMessage::CONTINUE)
+
+        bytes[0] = static_cast<juce::uint8>(status);
+        numBytes = 1;
+    }
+    else
+    {
+        return;
+    }
+
+    if (mode == MidiOutBMode::SysExTagged)
+    {
+        // F0 7D 42 <status & 0x7F> <data...> F7, as SysEx data bytes can't
+        // have the top bit set
+        juce::uint8 tagged[MidiOutputQueue::maxEventSize] = { 0xF0, 0x7D, 0x42 };
+
+        tagged[3] = static_cast<juce::uint8>(bytes[0] & 0x7F);
+
+        for (int i = 1; i < numBytes; i++)
         {
-            juceMsg = juce::MidiMessage::midiContinue();
-            compatibleMsg = true;
+            tagged[3 + i] = bytes[i];
         }
 
-        if (compatibleMsg)
+        tagged[3 + numBytes] = 0xF7;
+        queue.add(msg.bufferPos + sampleOffset, tagged, numBytes + 4);
+        return;
+    }
+
+    queue.add(msg.bufferPos + sampleOffset, bytes, numBytes);
+}
+
+void VmpcAudioProcessor::setStateCompression(SampleCodec::Level level)
+{
+    if (level != stateCompression)
+    {
+        stateCompression = level;
+        markStateDirty();
+    }
+}
+
+void VmpcAudioProcessor::setSampleStorage(SampleStorage storage)
+{
+    if (storage != sampleStorage)
+    {
+        sampleStorage = storage;
+        markStateDirty();
+
+        if (storage == SampleStorage::Referenced)
         {
-            midiMessages.addEvent(juceMsg, msg->bufferPos);
+            sampleFileIndex.lookUp(mpc.getSampler()->getSounds());
         }
-    };
-
-    const auto outputAEventCount = mpc.getMidiOutput()->dequeueOutputA(midiOutputBuffer);
+    }
+}
 
-    for (unsigned int i = 0; i < outputAEventCount; i++)
+void VmpcAudioProcessor::setMidiOutBMode(MidiOutBMode mode)
+{
+    if (midiOutBMode.exchange(mode) != mode)
     {
-        processMsg(midiOutputBuffer[i]);
+        markStateDirty();
     }
+}
 
-    // In JUCE we only have 1 set of 16 MIDI channels as far as I know.
-    // The MPC2000XL has 2 of those -- MIDI OUT A and MIDI OUT B. The below shows some
-    // example processing, but it's commented out, to restrict MIDI out processing
-    // to just MIDI OUT A.
+void VmpcAudioProcessor::setMidiOutBChannelOffset(int offset)
+{
+    offset = juce::jlimit(1, 15, offset);
+
+    if (midiOutBChannelOffset.exchange(offset) != offset)
+    {
+        markStateDirty();
+    }
+}
 
-//    const auto outputBEventCount = mpc.getMidiOutput()->dequeueOutputB(midiOutputBuffer);
-//
-//    for (int i = 0; i < outputBEventCount; i++)
-//    {
-//        processMsg(midiOutputBuffer[i]);
-//    }
+void VmpcAudioProcessor::setMidiOutputB(juce::MidiOutput* output)
+{
+    midiOutputB.setOutput(output);
 }
 
 void VmpcAudioProcessor::processTransport()
@@ -340,6 +513,7 @@ void VmpcAudioProcessor::processTransport()
     {
       mpc.getSequencer()->setTempo(tempo);
       m_Tempo = tempo;
+      markStateDirty();
     }
 
     bool isPlaying = info->getIsPlaying();
@@ -359,6 +533,7 @@ void VmpcAudioProcessor::processTransport()
 void VmpcAudioProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::MidiBuffer& midiMessages)
 {
   juce::ScopedNoDenormals noDenormals;
+  projectEditGate.publishBlock(mpc.getSequencer()->isRecording() || mpc.getSequencer()->isOverDubbing());
 
   const int totalNumInputChannels = getTotalNumInputChannels();
   const int totalNumOutputChannels = getTotalNumOutputChannels();
@@ -374,10 +549,23 @@ void VmpcAudioProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::Mid
     return;
   }
 
-  audioMidiServices->changeBounceStateIfRequired();
-  audioMidiServices->changeSoundRecorderStateIfRequired();
-  audioMidiServices->switchMidiControlMappingIfRequired();
+  // A host bounce must not render silence for sounds whose sample data is
+  // still streaming in, and can afford to wait for them
+  if (isNonRealtime() && !lazySoundLoader.isFinished())
+  {
+    finishLoadingSounds();
+  }
 
+  // Changes requested from the UI, like starting a recording, wait until a
+  // host bounce is over.
+  if (!isNonRealtime())
+  {
+    audioMidiServices->changeBounceStateIfRequired();
+    audioMidiServices->changeSoundRecorderStateIfRequired();
+    audioMidiServices->switchMidiControlMappingIfRequired();
+  }
+
+  // The engine's own direct to disk recording renders on its own thread
   if (!server->isRealTime())
   {
     for (int i = 0; i < totalNumInputChannels; ++i)
@@ -387,41 +575,133 @@ void VmpcAudioProcessor::processBlock(juce::AudioSampleBuffer& buffer, juce::Mid
   }
 
   processTransport();
-  processMidiIn(midiMessages);
 
+  midiInputBatch.fill(midiMessages);
+  midiMessages.clear();
+
+  auto sequencer = mpc.getSequencer();
+
+  if (!midiInputBatch.isEmpty() || sequencer->isRecording() || sequencer->isOverDubbing())
+  {
+    markStateDirty();
+  }
+
+  const int numSamples = buffer.getNumSamples();
   auto chDataIn = buffer.getArrayOfReadPointers();
-  auto chDataOut = buffer.getArrayOfWritePointers();
   int totalNumInputChannelsFinal = totalNumInputChannels;
-  int totalNumOutputChannelsFinal = totalNumOutputChannels;
 
   if (totalNumInputChannels == 1)
   {
     monoToStereoBufferIn.clear();
-    monoToStereoBufferIn.copyFrom(0, 0, buffer.getReadPointer(0), buffer.getNumSamples());
-    monoToStereoBufferIn.copyFrom(1, 0, buffer.getReadPointer(0), buffer.getNumSamples());
+    monoToStereoBufferIn.copyFrom(0, 0, buffer.getReadPointer(0), numSamples);
+    monoToStereoBufferIn.copyFrom(1, 0, buffer.getReadPointer(0), numSamples);
     chDataIn = monoToStereoBufferIn.getArrayOfReadPointers();
     totalNumInputChannelsFinal = 2;
   }
 
-  if (totalNumOutputChannels == 1)
+  jassert(totalNumInputChannelsFinal <= maxChannels);
+  totalNumInputChannelsFinal = std::min(totalNumInputChannelsFinal, maxChannels);
+
+  const int totalNumOutputChannelsFinal = mapOutputBuses(buffer);
+
+  // Render up to each MIDI event, so that the engine sees it on the sample
+  // it was sent for instead of at the start of the block. Events less than
+  // minimumSubBlockSize samples after the start of a sub-block are handled
+  // with that sub-block.
+  auto event = midiInputBatch.begin();
+  const auto eventsEnd = midiInputBatch.end();
+
+  midiOutputAQueue.clear();
+  midiOutputBQueue.clear();
+
+  for (int subBlockStart = 0; subBlockStart < numSamples;)
   {
-    monoToStereoBufferOut.clear();
-    chDataOut = monoToStereoBufferOut.getArrayOfWritePointers();
-    totalNumOutputChannelsFinal = 2;
+    auto subBlockEventsEnd = eventsEnd;
+    int subBlockEnd = numSamples;
+
+    if (sampleAccurateMidi)
+    {
+      subBlockEventsEnd = event;
+
+      while (subBlockEventsEnd != eventsEnd && subBlockEventsEnd->timestamp < subBlockStart + minimumSubBlockSize)
+      {
+        ++subBlockEventsEnd;
+      }
+
+      if (subBlockEventsEnd == eventsEnd || subBlockEventsEnd->timestamp >= numSamples)
+      {
+        subBlockEventsEnd = eventsEnd;
+      }
+      else
+      {
+        subBlockEnd = subBlockEventsEnd->timestamp;
+      }
+    }
+
+    processMidiIn(event, subBlockEventsEnd, subBlockStart);
+    event = subBlockEventsEnd;
+
+    for (int i = 0; i < totalNumInputChannelsFinal; i++)
+    {
+      subBlockIn[static_cast<size_t>(i)] = chDataIn[i] + subBlockStart;
+    }
+
+    for (int i = 0; i < totalNumOutputChannelsFinal; i++)
+    {
+      subBlockOut[static_cast<size_t>(i)] = blockOut[static_cast<size_t>(i)] + subBlockStart;
+    }
+
+    server->work(subBlockIn.data(), subBlockOut.data(), subBlockEnd - subBlockStart, totalNumInputChannelsFinal, totalNumOutputChannelsFinal);
+
+    processMidiOut(subBlockStart);
+
+    subBlockStart = subBlockEnd;
   }
 
-  server->work(chDataIn, chDataOut, buffer.getNumSamples(), totalNumInputChannelsFinal, totalNumOutputChannelsFinal);
+  midiOutputAQueue.writeTo(midiMessages);
 
-  processMidiOut(midiMessages);
+  if (midiOutputB.hasOutput() && !midiOutputBQueue.isEmpty())
+  {
+    midiOutputB.add(midiOutputBQueue, juce::Time::getMillisecondCounterHiRes(), getSampleRate());
+  }
 
   if (totalNumOutputChannels < 1)
   {
     buffer.clear();
   }
-  else if (totalNumOutputChannels == 1)
+
+  // Recording may have started during this block
+  projectEditGate.publishBlock(sequencer->isRecording() || sequencer->isOverDubbing());
+}
+
+int VmpcAudioProcessor::mapOutputBuses(juce::AudioSampleBuffer& buffer)
+{
+  // The engine renders STEREO OUT and MIX OUT 1/2 to 7/8 as consecutive
+  // channel pairs. Each pair goes straight into the channels of its host
+  // bus. Pairs of disabled buses and the right channel of a mono bus go to
+  // a scratch buffer, and pairs after the last enabled bus aren't rendered
+  // at all.
+  int numChannels = 0;
+
+  for (int bus = 0; bus < getBusCount(false) && (bus + 1) * 2 <= maxChannels; bus++)
   {
-    buffer.copyFrom(0, 0, monoToStereoBufferOut.getReadPointer(0), buffer.getNumSamples());
+    auto outputBus = getBus(false, bus);
+    const int busChannels = outputBus->isEnabled() ? outputBus->getNumberOfChannels() : 0;
+
+    if (busChannels > 0)
+    {
+      numChannels = (bus + 1) * 2;
+    }
+
+    for (int channel = 0; channel < 2; channel++)
+    {
+      blockOut[static_cast<size_t>(bus * 2 + channel)] = channel < busChannels
+          ? buffer.getWritePointer(outputBus->getChannelIndexInProcessBlockBuffer(channel))
+          : unusedOutputBuffer.getWritePointer(channel);
+    }
   }
+
+  return numChannels;
 }
 
 bool VmpcAudioProcessor::hasEditor() const
@@ -435,10 +715,10 @@ juce::AudioProcessorEditor* VmpcAudioProcessor::createEditor()
   return new VmpcAudioProcessorEditor (*this);
 }
 
-void VmpcAudioProcessor::getStateInformation(juce::MemoryBlock &destData)
+std::unique_ptr<juce::XmlElement> VmpcAudioProcessor::createUiStateXml()
 {
     auto editor = getActiveEditor();
-    auto root = std::make_shared<juce::XmlElement>("root");
+    auto root = std::make_unique<juce::XmlElement>("root");
 
     auto juce_ui = new juce::XmlElement("JUCE-UI");
     root->addChildElement(juce_ui);
@@ -451,10 +731,14 @@ void VmpcAudioProcessor::getStateInformation(juce::MemoryBlock &destData)
         juce_ui->setAttribute("h", h);
     }
 
+    juce_ui->setAttribute("stateCompression", static_cast<int>(stateCompression));
+    juce_ui->setAttribute("sampleStorage", static_cast<int>(sampleStorage));
+    juce_ui->setAttribute("midiOutB", static_cast<int>(getMidiOutBMode()));
+    juce_ui->setAttribute("midiOutBChannelOffset", getMidiOutBChannelOffset());
+
     if (juce::JUCEApplication::isStandaloneApp())
     {
-        copyXmlToBinary(*root.get(), destData);
-        return;
+        return root;
     }
 
     auto layeredScreen = mpc.getLayeredScreen();
@@ -479,60 +763,121 @@ void VmpcAudioProcessor::getStateInformation(juce::MemoryBlock &destData)
     mpc_ui->setAttribute("lastPressedPad", lastPressedPad);
     mpc_ui->setAttribute("currentDir", mpc.getDisk()->getAbsolutePath());
 
-    ApsParser apsParser(mpc, "stateinfo");
-    auto apsBytes = apsParser.getBytes();
-    auto sounds = mpc.getSampler()->getSounds();
+    return root;
+}
 
-    for (size_t i = 0; i < sounds.size(); i++)
+void VmpcAudioProcessor::getStateInformation(juce::MemoryBlock &destData)
+{
+    StateSnapshot snapshot;
+    snapshot.generation = stateCache.getGeneration();
+    snapshot.uiXml = createUiStateXml()->toString(juce::XmlElement::TextFormat().singleLine().withoutHeader()).toStdString();
+
+    if (stateCache.isClean(snapshot.generation, snapshot.uiXml))
     {
-        auto elementName = "sound" + std::to_string(i);
-        auto soundElement = new juce::XmlElement(elementName.c_str());
-        root->addChildElement(soundElement);
+        destData = stateCache.getBlob();
+        return;
+    }
 
-        auto sound = sounds[i];
-        SndWriter sndWriter(sound.get());
-        auto data = sndWriter.getSndFileArray();
+    const SampleFileIndex* fileIndex = nullptr;
+    auto isCurrent = true;
 
-        juce::MemoryOutputStream encodedSound;
-        juce::Base64::convertToBase64(encodedSound, &data[0], data.size());
+    if (!juce::JUCEApplication::isStandaloneApp())
+    {
+        isCurrent = captureProject(snapshot);
 
-        soundElement->setAttribute("data", encodedSound.toString());
-        soundElement->setAttribute("size", (int) data.size());
+        if (sampleStorage == SampleStorage::Referenced && snapshot.hasProject)
+        {
+            sampleFileIndex.lookUp(snapshot.sounds);
+            fileIndex = &sampleFileIndex;
+        }
     }
 
-    juce::MemoryOutputStream encodedAps;
-    juce::Base64::convertToBase64(encodedAps, &apsBytes[0], apsBytes.size());
+    // Written straight into destData while the previous blob is still
+    // around for its payloads, then copied into the cache once that blob
+    // is released. At most two blobs are alive at any time.
+    snapshot.writeTo(destData, stateCache, stateCompression, fileIndex);
+    stateCache.store(snapshot.generation, std::move(snapshot.uiXml), destData, stateCompression);
 
-    auto mpc_aps = new juce::XmlElement("MPC-APS");
-    root->addChildElement(mpc_aps);
+    // The next save captures the project again
+    if (!isCurrent)
+    {
+        markStateDirty();
+    }
+}
 
-    mpc_aps->setAttribute("data", encodedAps.toString());
-    mpc_aps->setAttribute("size", (int) apsBytes.size());
+StateSnapshot VmpcAudioProcessor::createStateSnapshot()
+{
+    StateSnapshot snapshot;
+    snapshot.generation = stateCache.getGeneration();
+    snapshot.uiXml = createUiStateXml()->toString(juce::XmlElement::TextFormat().singleLine().withoutHeader()).toStdString();
+
+    // Sounds that are still streaming in have no sample data yet, and the
+    // sequencer may be recording. Rather than finishing the restore on the
+    // message thread or journaling an older project, the autosaver tries
+    // again on its next tick.
+    if (lazySoundLoader.isFinished())
+    {
+        snapshot.captureProject(mpc, projectEditGate);
+    }
 
-    AllParser allParser(mpc);
-    auto allBytes = allParser.getBytes();
+    return snapshot;
+}
 
-    juce::MemoryOutputStream encodedAll;
-    juce::Base64::convertToBase64(encodedAll, &allBytes[0], allBytes.size());
+bool VmpcAudioProcessor::captureProject(StateSnapshot& snapshot)
+{
+    // Sounds that are still being restored in the background have no sample data yet
+    lazySoundLoader.finish();
 
-    auto mpc_all = new juce::XmlElement("MPC-ALL");
-    root->addChildElement(mpc_all);
-    mpc_all->setAttribute("data", encodedAll.toString());
-    mpc_all->setAttribute("size", (int) allBytes.size());
+    const juce::ScopedLock sl(lastProjectLock);
 
-    copyXmlToBinary(*root.get(), destData);
+    if (snapshot.captureProject(mpc, projectEditGate))
+    {
+        lastProject.hasProject = true;
+        lastProject.aps = snapshot.aps;
+        lastProject.all = snapshot.all;
+        lastProject.sounds = snapshot.sounds;
+        return true;
+    }
+
+    // The sequencer is recording, so the project is saved as it was before
+    // and the take goes into the next save after recording.
+    moduru::Logger::l.log("Saving the project as it was before recording started\n");
+    snapshot.hasProject = lastProject.hasProject;
+    snapshot.aps = lastProject.aps;
+    snapshot.all = lastProject.all;
+    snapshot.sounds = lastProject.sounds;
+    return false;
 }
 
 void VmpcAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    std::shared_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+    lazySoundLoader.cancel();
+    markStateDirty();
 
-    auto juce_ui = xmlState->getChildByName("JUCE-UI");
+    if (!StateChunks::isChunkedState(data, static_cast<size_t>(sizeInBytes)))
+    {
+        setLegacyStateInformation(data, sizeInBytes);
+        return;
+    }
 
-    if (juce_ui != nullptr)
+    StateChunkReader reader(data, static_cast<size_t>(sizeInBytes));
+
+    if (!reader.isValid())
     {
-        lastUIWidth = juce_ui->getIntAttribute("w", 1298 / 2);
-        lastUIHeight = juce_ui->getIntAttribute("h", 994 / 2);
+        moduru::Logger::l.log("Ignoring plugin state with an unsupported or corrupt chunk table\n");
+        return;
+    }
+
+    std::unique_ptr<juce::XmlElement> uiXml;
+
+    if (auto uiChunk = reader.getFirst(StateChunks::ui))
+    {
+        uiXml = juce::parseXML(juce::String::fromUTF8(uiChunk->data, static_cast<int>(uiChunk->size)));
+    }
+
+    if (uiXml != nullptr)
+    {
+        restoreJuceUi(uiXml->getChildByName("JUCE-UI"));
     }
 
     if (juce::JUCEApplication::isStandaloneApp())
@@ -540,6 +885,117 @@ void VmpcAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
         return;
     }
 
+    restoreProject(reader);
+
+    if (uiXml != nullptr)
+    {
+        restoreMpcUi(uiXml->getChildByName("MPC-UI"));
+    }
+}
+
+void VmpcAudioProcessor::restoreProject(const StateChunkReader& reader)
+{
+    auto toVector = [](const StateChunks::Chunk* chunk) {
+        return std::vector<char>(chunk->data, chunk->data + chunk->size);
+    };
+
+    if (auto apsChunk = reader.getFirst(StateChunks::aps))
+    {
+        restoreAps(toVector(apsChunk));
+
+        auto sndChunks = reader.getAll(StateChunks::snd);
+
+        SoundChunks::restoreSndFiles(mpc, sndChunks.size(), [&](size_t i) {
+            return toVector(sndChunks[i]);
+        });
+
+        const auto missingSounds = SoundChunks::restoreSounds(mpc, reader, soundRestoreMode == SoundRestoreMode::Lazy ? &lazySoundLoader : nullptr,
+                                                              sampleFileIndex.getRoot());
+
+        if (!missingSounds.empty())
+        {
+            reportMissingSampleData(missingSounds);
+        }
+    }
+
+    if (auto allChunk = reader.getFirst(StateChunks::all))
+    {
+        restoreAll(toVector(allChunk));
+    }
+}
+
+void VmpcAudioProcessor::reportMissingSampleData(const std::vector<std::string>& soundNames)
+{
+    juce::StringArray names;
+
+    for (auto& name : soundNames)
+    {
+        names.addIfNotAlreadyThere(juce::String(name).trim());
+    }
+
+    juce::MessageManager::callAsync([names]() {
+        juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Missing sample data",
+                                               "The sample data of these sounds could not be loaded, so they are empty:\n\n"
+                                               + names.joinIntoString(", ")
+                                               + "\n\nSounds that are saved as a reference need their SND file in the stores "
+                                                 "directory, unchanged. Load the sounds again and save the project to fix this.");
+    });
+}
+
+void VmpcAudioProcessor::startStandaloneSession()
+{
+    const auto journalFile = juce::File(mpc::Paths::logFilePath()).getSiblingFile("autosave.journal");
+
+    juce::int64 validJournalSize;
+    const auto journaledState = AutosaveJournal::recover(journalFile, validJournalSize);
+    StateChunkReader reader(journaledState.getData(), journaledState.getSize());
+
+    // AutoSave only stores the session on a clean exit, so the journal is
+    // at least as recent, and newer after a crash. It replaces AutoSave's
+    // restore when that would load without asking. With loading on start
+    // off or set to ask, AutoSave decides and the journal starts over.
+    constexpr int autoLoadEnabled = 2;
+    const auto autoLoadOnStart = mpc.screens->get<VmpcAutoSaveScreen>("vmpc-auto-save")->getAutoLoadOnStart();
+    const auto replayJournal = reader.isValid() && autoLoadOnStart == autoLoadEnabled;
+
+    if (replayJournal)
+    {
+        restoreProject(reader);
+    }
+    else
+    {
+        mpc::AutoSave::restoreAutoSavedState(mpc);
+    }
+
+    stateAutosaver = std::make_unique<StateAutosaver>(
+            journalFile, replayJournal ? validJournalSize : 0,
+            [this]() { return stateCache.getGeneration(); },
+            [this]() { return createStateSnapshot(); });
+
+    if (replayJournal)
+    {
+        stateAutosaver->setJournaledState(reader);
+    }
+
+    stateAutosaver->start(autosaveIntervalMs);
+}
+
+void VmpcAudioProcessor::setLegacyStateInformation(const void* data, int sizeInBytes)
+{
+    std::shared_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
+
+    if (xmlState == nullptr)
+    {
+        return;
+    }
+
+    restoreJuceUi(xmlState->getChildByName("JUCE-UI"));
+
+    if (juce::JUCEApplication::isStandaloneApp())
+    {
+        return;
+    }
+
     auto decodeBase64 = [](juce::XmlElement *element) {
         juce::MemoryOutputStream decoded;
         juce::Base64::convertFromBase64(decoded, element->getStringAttribute("data"));
@@ -551,121 +1007,169 @@ void VmpcAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 
     if (mpc_aps != nullptr)
     {
-        std::vector<char> apsData = decodeBase64(mpc_aps);
-        if (apsData.size() > 0)
-        {
-            ApsParser apsParser(mpc, apsData);
-            // We don't want the APS loader to attempt to load the sounds
-            // from the file system. We load them manually from the
-            // decode project state.
-            auto withoutSounds = true;
-
-            // We don't need popups to appear in the LCD UI.
-            auto headless = true;
+        restoreAps(decodeBase64(mpc_aps));
 
-            ApsLoader::loadFromParsedAps(apsParser, mpc, withoutSounds, headless);
-        }
+        std::vector<juce::XmlElement*> soundElements;
 
-        int counter = 0;
-
-        auto candidateName = "sound" + std::to_string(counter);
+        auto candidateName = "sound" + std::to_string(soundElements.size());
         auto candidate = xmlState->getChildByName(candidateName);
 
         while (candidate != nullptr)
         {
-            auto sndData = decodeBase64(candidate);
-            SndReader sndReader(sndData);
-
-            auto sound = mpc.getSampler()->addSound(sndReader.getSampleRate());
-            sound->setMono(sndReader.isMono());
-            sndReader.readData(*sound->getSampleData());
-            sound->setName(sndReader.getName());
-            sound->setTune(sndReader.getTune());
-            sound->setLevel(sndReader.getLevel());
-            sound->setStart(sndReader.getStart());
-            sound->setEnd(sndReader.getEnd());
-            sound->setLoopTo(sound->getEnd() - sndReader.getLoopLength());
-            sound->setBeatCount(sndReader.getNumberOfBeats());
-            sound->setLoopEnabled(sndReader.isLoopEnabled());
-
-            counter++;
-
-            candidateName = "sound" + std::to_string(counter);
+            soundElements.push_back(candidate);
+
+            candidateName = "sound" + std::to_string(soundElements.size());
             candidate = xmlState->getChildByName(candidateName);
         }
+
+        SoundChunks::restoreSndFiles(mpc, soundElements.size(), [&](size_t i) {
+            return decodeBase64(soundElements[i]);
+        });
     }
 
     auto mpc_all = xmlState->getChildByName("MPC-ALL");
 
     if (mpc_all != nullptr)
     {
-        std::vector<char> allData = decodeBase64(mpc_all);
-
-        if (allData.size() > 0)
-        {
-            AllParser allParser(mpc, allData);
-            AllLoader::loadEverythingFromAllParser(mpc, allParser);
-        }
+        restoreAll(decodeBase64(mpc_all));
     }
 
-    auto mpc_ui = xmlState->getChildByName("MPC-UI");
+    restoreMpcUi(xmlState->getChildByName("MPC-UI"));
+}
 
-    if (mpc_ui != nullptr)
+void VmpcAudioProcessor::restoreJuceUi(const juce::XmlElement* juce_ui)
+{
+    if (juce_ui != nullptr)
     {
-        auto currentDir = mpc_ui->getStringAttribute("currentDir").toStdString();
-        auto storesPath = mpc::Paths::storesPath() + "MPC2000XL";
-        auto resPathIndex = currentDir.find(storesPath);
+        lastUIWidth = juce_ui->getIntAttribute("w", 1298 / 2);
+        lastUIHeight = juce_ui->getIntAttribute("h", 994 / 2);
 
-        if (resPathIndex != std::string::npos)
+        const auto compression = juce_ui->getIntAttribute("stateCompression", static_cast<int>(SampleCodec::Level::Fast));
+
+        if (compression >= static_cast<int>(SampleCodec::Level::None) && compression <= static_cast<int>(SampleCodec::Level::Small))
         {
-            auto trimmedCurrentDir = currentDir.substr(resPathIndex + storesPath.length());
-            auto splitTrimmedDir = StrUtil::split(trimmedCurrentDir, FileUtil::getSeparator()[0]);
+            setStateCompression(static_cast<SampleCodec::Level>(compression));
+        }
 
-            for (auto &s: splitTrimmedDir)
-            {
-                mpc.getDisk()->moveForward(s);
-                mpc.getDisk()->initFiles();
-            }
+        const auto storage = juce_ui->getIntAttribute("sampleStorage", static_cast<int>(SampleStorage::Embedded));
+
+        if (storage == static_cast<int>(SampleStorage::Embedded) || storage == static_cast<int>(SampleStorage::Referenced))
+        {
+            setSampleStorage(static_cast<SampleStorage>(storage));
         }
 
-        mpc.getSampler()->setSoundIndex(mpc_ui->getIntAttribute("soundIndex"));
-        mpc.setNote(mpc_ui->getIntAttribute("lastPressedNote"));
-        mpc.setPad(static_cast<unsigned char>(mpc_ui->getIntAttribute("lastPressedPad")));
+        const auto mode = juce_ui->getIntAttribute("midiOutB", static_cast<int>(MidiOutBMode::Off));
 
-        auto previousSamplerScreen = mpc_ui->getStringAttribute("previousSamplerScreen").toStdString();
-        mpc.setPreviousSamplerScreenName(previousSamplerScreen);
+        if (mode >= static_cast<int>(MidiOutBMode::Off) && mode <= static_cast<int>(MidiOutBMode::SysExTagged))
+        {
+            setMidiOutBMode(static_cast<MidiOutBMode>(mode));
+        }
 
-        auto screen = mpc_ui->getStringAttribute("screen").toStdString();
-        auto previousScreen = mpc_ui->getStringAttribute("previousScreen").toStdString();
-        auto layeredScreen = mpc.getLayeredScreen();
+        setMidiOutBChannelOffset(juce_ui->getIntAttribute("midiOutBChannelOffset", 8));
+    }
+}
 
-        auto currentScreen = layeredScreen->getCurrentScreenName();
+void VmpcAudioProcessor::restoreAps(std::vector<char> apsData)
+{
+    if (apsData.empty())
+    {
+        return;
+    }
 
-        layeredScreen->openScreen(previousSamplerScreen.empty() ? "sequencer" : previousSamplerScreen);
-        layeredScreen->Draw();
-        layeredScreen->openScreen(previousScreen);
-        layeredScreen->Draw();
+    ApsParser apsParser(mpc, apsData);
+    // We don't want the APS loader to attempt to load the sounds
+    // from the file system. We load them manually from the
+    // decode project state.
+    auto withoutSounds = true;
 
-        auto directoryScreen = mpc.screens->get<DirectoryScreen>("directory");
-        directoryScreen->setPreviousScreenName(previousScreen == "save" ? "save" : "load");
+    // We don't need popups to appear in the LCD UI.
+    auto headless = true;
 
-        layeredScreen->openScreen(screen);
-        auto focus = mpc_ui->getStringAttribute("focus").toStdString();
-        layeredScreen->Draw();
+    ApsLoader::loadFromParsedAps(apsParser, mpc, withoutSounds, headless);
 
-        if (!focus.empty())
-        {
-            layeredScreen->setFocus(focus);
-        }
+    const juce::ScopedLock sl(lastProjectLock);
+    lastProject.hasProject = true;
+    lastProject.aps = std::move(apsData);
+}
+
+void VmpcAudioProcessor::restoreAll(std::vector<char> allData)
+{
+    if (allData.empty())
+    {
+        return;
+    }
+
+    AllParser allParser(mpc, allData);
+    AllLoader::loadEverythingFromAllParser(mpc, allParser);
+
+    // The sounds were restored in between, and the restored project is what
+    // saves fall back on until it is captured again
+    const juce::ScopedLock sl(lastProjectLock);
+    lastProject.hasProject = true;
+    lastProject.all = std::move(allData);
+    lastProject.sounds = mpc.getSampler()->getSounds();
+}
+
+void VmpcAudioProcessor::restoreMpcUi(const juce::XmlElement* mpc_ui)
+{
+    if (mpc_ui == nullptr)
+    {
+        return;
+    }
 
-        if (currentScreen == "vmpc-known-controller-detected")
+    auto currentDir = mpc_ui->getStringAttribute("currentDir").toStdString();
+    auto storesPath = mpc::Paths::storesPath() + "MPC2000XL";
+    auto resPathIndex = currentDir.find(storesPath);
+
+    if (resPathIndex != std::string::npos)
+    {
+        auto trimmedCurrentDir = currentDir.substr(resPathIndex + storesPath.length());
+        auto splitTrimmedDir = StrUtil::split(trimmedCurrentDir, FileUtil::getSeparator()[0]);
+
+        for (auto &s: splitTrimmedDir)
         {
-            layeredScreen->openScreen(currentScreen);
-            layeredScreen->Draw();
+            mpc.getDisk()->moveForward(s);
+            mpc.getDisk()->initFiles();
         }
+    }
+
+    mpc.getSampler()->setSoundIndex(mpc_ui->getIntAttribute("soundIndex"));
+    mpc.setNote(mpc_ui->getIntAttribute("lastPressedNote"));
+    mpc.setPad(static_cast<unsigned char>(mpc_ui->getIntAttribute("lastPressedPad")));
+
+    auto previousSamplerScreen = mpc_ui->getStringAttribute("previousSamplerScreen").toStdString();
+    mpc.setPreviousSamplerScreenName(previousSamplerScreen);
+
+    auto screen = mpc_ui->getStringAttribute("screen").toStdString();
+    auto previousScreen = mpc_ui->getStringAttribute("previousScreen").toStdString();
+    auto layeredScreen = mpc.getLayeredScreen();
+
+    auto currentScreen = layeredScreen->getCurrentScreenName();
 
-        layeredScreen->setDirty();
+    layeredScreen->openScreen(previousSamplerScreen.empty() ? "sequencer" : previousSamplerScreen);
+    layeredScreen->Draw();
+    layeredScreen->openScreen(previousScreen);
+    layeredScreen->Draw();
+
+    auto directoryScreen = mpc.screens->get<DirectoryScreen>("directory");
+    directoryScreen->setPreviousScreenName(previousScreen == "save" ? "save" : "load");
+
+    layeredScreen->openScreen(screen);
+    auto focus = mpc_ui->getStringAttribute("focus").toStdString();
+    layeredScreen->Draw();
+
+    if (!focus.empty())
+    {
+        layeredScreen->setFocus(focus);
     }
+
+    if (currentScreen == "vmpc-known-controller-detected")
+    {
+        layeredScreen->openScreen(currentScreen);
+        layeredScreen->Draw();
+    }
+
+    layeredScreen->setDirty();
 }
 
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
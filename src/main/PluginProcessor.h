@@ -4,7 +4,20 @@
 
 #include <Mpc.hpp>
 
+#include <array>
+#include <atomic>
+
 #include "gui/VmpcLookAndFeel.h"
+#include "state/StateCache.h"
+#include "state/LazySoundLoader.h"
+#include "state/StateSnapshot.h"
+#include "state/ProjectEditGate.h"
+#include "state/StateAutosaver.h"
+#include "state/SampleFileIndex.h"
+#include "state/WorkerPool.h"
+#include "midi/MidiEventBatch.h"
+#include "midi/MidiOutputQueue.h"
+#include "midi/MidiOutputSender.h"
 
 namespace ctoot::midi::core { class ShortMessage; }
 
@@ -22,6 +35,8 @@ public:
   bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
   
   void processBlock (juce::AudioSampleBuffer&, juce::MidiBuffer&) override;
+
+  void setNonRealtime (bool isNonRealtime) noexcept override;
   
   //==============================================================================
   juce::AudioProcessorEditor* createEditor() override;
@@ -45,23 +60,136 @@ public:
   //==============================================================================
   void getStateInformation (juce::MemoryBlock& destData) override;
   void setStateInformation (const void* data, int sizeInBytes) override;
+
+  // Call whenever the sampler, sequencer or MPC UI state may have changed, so
+  // the next getStateInformation doesn't hand out a stale cached blob.
+  void markStateDirty() { stateCache.markDirty(); }
+
+  // Captures the current state while audio keeps running. The snapshot can
+  // then be serialized on another thread. It has no project while sounds
+  // are still streaming in after a restore or while the sequencer records.
+  StateSnapshot createStateSnapshot();
   
   int lastUIWidth = 1298/2, lastUIHeight = 994/2;
   
 private:
-  void processMidiIn(juce::MidiBuffer& midiMessages);
-  void processMidiOut(juce::MidiBuffer& midiMessages);
+  void processMidiIn(const MidiEventBatch::Event* begin, const MidiEventBatch::Event* end, int sampleOffset);
+  void processMachineControl(int command);
+  void processMidiOut(int sampleOffset);
+  void addMidiOutMessage(MidiOutputQueue& queue, const ctoot::midi::core::ShortMessage& msg, int sampleOffset, bool mergePortB);
   void processTransport();
+  int mapOutputBuses(juce::AudioSampleBuffer& buffer);
+
+  std::unique_ptr<juce::XmlElement> createUiStateXml();
+  // Falls back on the last captured or restored project while the audio
+  // thread may edit it, in which case it returns false.
+  bool captureProject(StateSnapshot&);
+  void setLegacyStateInformation(const void* data, int sizeInBytes);
+  void restoreJuceUi(const juce::XmlElement*);
+  void restoreAps(std::vector<char> apsData);
+  void restoreAll(std::vector<char> allData);
+  void restoreMpcUi(const juce::XmlElement*);
+  void restoreProject(const StateChunkReader&);
+  // Decodes and commits the sample data that is still streaming in, for
+  // offline rendering. Logs rather than throws.
+  void finishLoadingSounds();
+  // Tells the user, on the message thread, which sounds were restored empty
+  static void reportMissingSampleData(const std::vector<std::string>& soundNames);
+  // Restores the last standalone session and starts journaling it
+  void startStandaloneSession();
 
   juce::AudioSampleBuffer monoToStereoBufferIn;
-  juce::AudioSampleBuffer monoToStereoBufferOut;
+  juce::AudioSampleBuffer unusedOutputBuffer;
   double m_Tempo = 0;
   bool wasPlaying = false;
 
+  // Keeps the shared worker threads running while this instance exists
+  juce::SharedResourcePointer<WorkerPool> workerPool;
+
+  ProjectEditGate projectEditGate;
+  juce::CriticalSection lastProjectLock;
+  StateSnapshot lastProject;
+  StateCache stateCache;
+  LazySoundLoader lazySoundLoader;
+  SampleFileIndex sampleFileIndex;
+
+  // Standalone only
+  static constexpr int autosaveIntervalMs = 10000;
+  std::unique_ptr<StateAutosaver> stateAutosaver;
+
   VmpcLookAndFeel* lookAndFeel;
+  std::unique_ptr<ctoot::midi::core::ShortMessage> midiInputMessage;
+  MidiEventBatch midiInputBatch;
+  static constexpr int maxChannels = 32;
+  std::array<float*, maxChannels> blockOut {};
+  std::array<const float*, maxChannels> subBlockIn {};
+  std::array<float*, maxChannels> subBlockOut {};
+  MidiOutputQueue midiOutputAQueue;
+  MidiOutputQueue midiOutputBQueue;
+  MidiOutputSender midiOutputB;
+  // MpcMidiOutput hands out its messages as shared pointers. They are
+  // translated into the queues above right after dequeueing.
   std::vector<std::shared_ptr<ctoot::midi::core::ShortMessage>> midiOutputBuffer = std::vector<std::shared_ptr<ctoot::midi::core::ShortMessage>>(100);
 
 public:
+  // Lazy restores register all sounds right away and stream their sample
+  // data in afterwards, so sessions open without waiting for the samples.
+  enum class SoundRestoreMode { Eager, Lazy };
+  SoundRestoreMode soundRestoreMode = SoundRestoreMode::Lazy;
+
+  // Compression of the sample data in the plugin state. Fast keeps saving
+  // cheap enough for frequent host saves, Small trades save time for size.
+  void setStateCompression(SampleCodec::Level);
+  SampleCodec::Level getStateCompression() const { return stateCompression; }
+
+  // Referenced sample data that is already in an SND file under the stores
+  // directory is saved as a path and hash instead of being embedded, which
+  // keeps the plugin state small no matter how much sample data a project
+  // has. Sounds that aren't on disk, e.g. because they were edited, are
+  // still embedded. If a referenced file changes or disappears, its sounds
+  // are restored empty and the user is told which ones.
+  enum class SampleStorage { Embedded, Referenced };
+  void setSampleStorage(SampleStorage);
+  SampleStorage getSampleStorage() const { return sampleStorage; }
+
+private:
+  SampleCodec::Level stateCompression = SampleCodec::Level::Fast;
+  SampleStorage sampleStorage = SampleStorage::Embedded;
+
+public:
+  // Splits rendering at MIDI input timestamps, so pads trigger on the sample
+  // they were played on at any buffer size. A sub-block is at least
+  // minimumSubBlockSize samples long, which bounds the extra engine calls
+  // to one per minimumSubBlockSize samples. Measured by
+  // vmpc2000xl_MidiBenchmarks.
+  bool sampleAccurateMidi = true;
+  static constexpr int minimumSubBlockSize = 32;
+
+  // The MPC has two MIDI outputs. Port A goes to the host's MIDI output.
+  // Port B goes to the device set with setMidiOutputB in the standalone app,
+  // otherwise it is merged into the host's MIDI output as chosen here: with
+  // its channels moved up by the channel offset, or wrapped in SysEx as
+  // F0 7D 42 <status & 0x7F> <data...> F7 for the host to route. Port B
+  // notes whose channel would end up past 16 are dropped. Both settings
+  // are saved with the plugin state and are safe to change while audio is
+  // running.
+  enum class MidiOutBMode { Off, ChannelOffset, SysExTagged };
+  void setMidiOutBMode(MidiOutBMode);
+  MidiOutBMode getMidiOutBMode() const { return midiOutBMode.load(); }
+  // 1 to 15
+  void setMidiOutBChannelOffset(int);
+  int getMidiOutBChannelOffset() const { return midiOutBChannelOffset.load(); }
+
+  // The output stays owned by the caller, who must keep it open until it
+  // is replaced. Safe to call while audio is running.
+  void setMidiOutputB(juce::MidiOutput* output);
+
+private:
+  std::atomic<MidiOutBMode> midiOutBMode { MidiOutBMode::Off };
+  std::atomic<int> midiOutBChannelOffset { 8 };
+
+public:
+
   bool shouldShowDisclaimer = true;
   std::function<void()> showAudioSettingsDialog = [](){};
   mpc::Mpc mpc;
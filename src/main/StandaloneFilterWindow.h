@@ -57,6 +57,10 @@ public:
     {
         setupAudioDevices (enableAudioInput, preferredDefaultDeviceName, options.get());
         reloadPluginState();
+
+        if (settings != nullptr)
+            setMidiOutputB (settings->getValue ("midiOutputB"));
+
         startPlaying();
 
        if (autoOpenMidiDevices)
@@ -207,6 +211,32 @@ public:
         player.setProcessor (nullptr);
     }
 
+    //==============================================================================
+    /** Opens the device that MIDI OUT B of the MPC goes to, or closes it if
+        the identifier is empty.
+    */
+    void setMidiOutputB (const String& identifier)
+    {
+        std::unique_ptr<MidiOutput> newOutput;
+
+        if (identifier.isNotEmpty())
+            newOutput = MidiOutput::openDevice (identifier);
+
+        if (auto* vmpcProcessor = dynamic_cast<VmpcAudioProcessor*> (processor.get()))
+            vmpcProcessor->setMidiOutputB (newOutput.get());
+
+        // The processor has let go of the previous device by now
+        midiOutputB = std::move (newOutput);
+
+        if (settings != nullptr)
+            settings->setValue ("midiOutputB", identifier);
+    }
+
+    String getMidiOutputBIdentifier() const
+    {
+        return midiOutputB != nullptr ? midiOutputB->getIdentifier() : String();
+    }
+
     //==============================================================================
     /** Shows an audio properties dialog box modally. */
     void showAudioSettingsDialog()
@@ -352,6 +382,7 @@ public:
     Array<MidiDeviceInfo> lastMidiDevices;
 
     std::unique_ptr<FileChooser> stateFileChooser;
+    std::unique_ptr<MidiOutput> midiOutputB;
 
 private:
     /*  This class can be used to ensure that audio callbacks use buffers with a
@@ -459,6 +490,34 @@ private:
             setOpaque (true);
 
             addAndMakeVisible (deviceSelector);
+
+            midiOutputBLabel.setText (TRANS("MIDI OUT B:"), dontSendNotification);
+            midiOutputBLabel.setJustificationType (Justification::centredRight);
+            addAndMakeVisible (midiOutputBLabel);
+
+            midiOutputBDevices = MidiOutput::getAvailableDevices();
+            midiOutputBSelector.addItem (TRANS("<< none >>"), 1);
+
+            for (int i = 0; i < midiOutputBDevices.size(); ++i)
+            {
+                midiOutputBSelector.addItem (midiOutputBDevices.getReference (i).name, i + 2);
+
+                if (midiOutputBDevices.getReference (i).identifier == owner.getMidiOutputBIdentifier())
+                    midiOutputBSelector.setSelectedId (i + 2, dontSendNotification);
+            }
+
+            if (midiOutputBSelector.getSelectedId() == 0)
+                midiOutputBSelector.setSelectedId (1, dontSendNotification);
+
+            midiOutputBSelector.onChange = [this]
+            {
+                const auto index = midiOutputBSelector.getSelectedId() - 2;
+                owner.setMidiOutputB (isPositiveAndBelow (index, midiOutputBDevices.size())
+                                          ? midiOutputBDevices.getReference (index).identifier
+                                          : String());
+            };
+
+            addAndMakeVisible (midiOutputBSelector);
         }
 
         void paint (Graphics& g) override
@@ -472,6 +531,11 @@ private:
 
             auto r = getLocalBounds();
 
+            // Lined up with the MIDI output row of the device selector
+            auto midiOutputBRow = r.removeFromBottom (midiOutputBRowHeight).reduced (0, 4);
+            midiOutputBLabel.setBounds (midiOutputBRow.removeFromLeft (getWidth() * 35 / 100).withTrimmedRight (10));
+            midiOutputBSelector.setBounds (midiOutputBRow.withTrimmedRight (getWidth() / 10).withHeight (24));
+
             deviceSelector.setBounds (r);
         }
 
@@ -483,13 +547,18 @@ private:
 
         void setToRecommendedSize()
         {
-            setSize (getWidth(), deviceSelector.getHeight());
+            setSize (getWidth(), deviceSelector.getHeight() + midiOutputBRowHeight);
         }
 
     private:
         //==============================================================================
+        static constexpr int midiOutputBRowHeight = 32;
+
         StandalonePluginHolder& owner;
         AudioDeviceSelectorComponent deviceSelector;
+        Label midiOutputBLabel;
+        ComboBox midiOutputBSelector;
+        Array<MidiDeviceInfo> midiOutputBDevices;
         bool isResizing = false;
 
         //==============================================================================
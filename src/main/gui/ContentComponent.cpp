@@ -70,10 +70,12 @@ ContentComponent::ContentComponent(mpc::Mpc &_mpc, std::function<void()>& showAu
 
     keyboard->onKeyDownFn = [&](int keyCode) {
         keyEventHandler.lock()->handle(mpc::controls::KeyEvent(keyCode, true));
+        onUserInteraction();
     };
 
     keyboard->onKeyUpFn = [&](int keyCode) {
         keyEventHandler.lock()->handle(mpc::controls::KeyEvent(keyCode, false));
+        onUserInteraction();
     };
 
     setWantsKeyboardFocus(true);
@@ -184,12 +186,13 @@ ContentComponent::ContentComponent(mpc::Mpc &_mpc, std::function<void()>& showAu
     versionLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
     addAndMakeVisible(versionLabel);
 
-    if (juce::JUCEApplicationBase::isStandaloneApp())
+    if (juce::JUCEApplicationBase::isStandaloneApp() ||
+        juce::SystemStats::getOperatingSystemType() != juce::SystemStats::OperatingSystemType::iOS)
     {
         gearImg = ResourceUtil::loadImage("img/gear.png");
         gearButton.setImages(false, true, true, gearImg, 0.5, transparentWhite, gearImg, 1.0, transparentWhite,
                              gearImg, 0.25, transparentWhite);
-        gearButton.setTooltip("Audio/MIDI Settings");
+        gearButton.setTooltip(juce::JUCEApplicationBase::isStandaloneApp() ? "Audio/MIDI Settings" : "Plugin Settings");
         gearButton.onClick = [&showAudioSettingsDialog]() {
             showAudioSettingsDialog();
         };
@@ -216,6 +219,10 @@ ContentComponent::ContentComponent(mpc::Mpc &_mpc, std::function<void()>& showAu
     }
 
     juce::Desktop::getInstance().addFocusChangeListener(this);
+
+    // Get notified of mouse interaction with any of the hardware controls
+    interactionListener.onInteraction = [&]() { onUserInteraction(); };
+    addMouseListener(&interactionListener, true);
 }
 
 ContentComponent::~ContentComponent()
@@ -226,6 +233,7 @@ ContentComponent::~ContentComponent()
   }
 
   juce::Desktop::getInstance().removeFocusChangeListener(this);
+    removeMouseListener(&interactionListener);
     delete keyboard;
     delete dataWheel;
 
@@ -301,11 +309,8 @@ void ContentComponent::resized()
         resetWindowSizeButton.setBounds(1298 - (145 + 20), 13, 45, 45);
         resetWindowSizeButton.setTransform(scaleTransform);
 
-        if (juce::JUCEApplicationBase::isStandaloneApp())
-        {
-            gearButton.setBounds(1298 - (190 + 30), 13, 45, 45);
-            gearButton.setTransform(scaleTransform);
-        }
+        gearButton.setBounds(1298 - (190 + 30), 13, 45, 45);
+        gearButton.setTransform(scaleTransform);
     }
   
 #if ENABLE_IMPORT
@@ -325,10 +330,12 @@ void ContentComponent::globalFocusChanged(juce::Component *)
 
         keyboard->onKeyDownFn = [&](int keyCode) {
             keyEventHandler.lock()->handle(mpc::controls::KeyEvent(keyCode, true));
+            onUserInteraction();
         };
 
         keyboard->onKeyUpFn = [&](int keyCode) {
             keyEventHandler.lock()->handle(mpc::controls::KeyEvent(keyCode, false));
+            onUserInteraction();
         };
     }
     keyboard->allKeysUp();
@@ -53,11 +53,24 @@ public:
 
   Keyboard* keyboard = nullptr;
 
+  // Invoked on every key, mouse and wheel interaction with the hardware controls
+  std::function<void()> onUserInteraction = [](){};
+
   bool keyPressed(const juce::KeyPress &key) override;
   void resized() override;
   void globalFocusChanged(juce::Component*) override;
 
 private:
+  struct InteractionListener : public juce::MouseListener
+  {
+    std::function<void()> onInteraction;
+    void mouseDown(const juce::MouseEvent&) override { onInteraction(); }
+    void mouseDrag(const juce::MouseEvent&) override { onInteraction(); }
+    void mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails&) override { onInteraction(); }
+  };
+
+  InteractionListener interactionListener;
+
 #if ENABLE_IMPORT
   VmpcURLProcessor urlProcessor;
 #endif
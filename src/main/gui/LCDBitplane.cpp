@@ -0,0 +1,24 @@
+#include "LCDBitplane.h"
+
+bool LCDBitplane::isDirty() const noexcept
+{
+    for (auto row : dirtyTiles)
+    {
+        if (row != 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void LCDBitplane::markAllDirty() noexcept
+{
+    dirtyTiles.fill((uint32_t(1) << tileColumns) - 1);
+}
+
+juce::Rectangle<int> LCDBitplane::getTileArea(int column, int row)
+{
+    return juce::Rectangle<int>(column * tileSize, row * tileSize, tileSize, tileSize).getIntersection({ width, height });
+}
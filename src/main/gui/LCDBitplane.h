@@ -0,0 +1,88 @@
+#pragma once
+
+#include <juce_graphics/juce_graphics.h>
+
+#include <array>
+#include <cstdint>
+
+// The pixels of the 248x60 LCD as a packed, row-major bitplane, with a
+// dirty bit per 8x8 tile.
+//
+// LayeredScreen hands out its pixels as a nested [x][y] bool container with
+// one bounding rectangle of what changed. Copying that rectangle in here
+// narrows it down to the tiles in which a pixel actually flipped, so two
+// small changes in opposite corners re-rasterize two tiles rather than
+// nearly the whole screen.
+class LCDBitplane
+{
+public:
+    static constexpr int width = 248;
+    static constexpr int height = 60;
+    static constexpr int tileSize = 8;
+    static constexpr int tileColumns = (width + tileSize - 1) / tileSize;
+    static constexpr int tileRows = (height + tileSize - 1) / tileSize;
+
+    LCDBitplane() { markAllDirty(); }
+
+    // Copies an area of LayeredScreen::getPixels() and marks the tiles in
+    // which a pixel changed.
+    template <typename Pixels>
+    void copyFrom(const Pixels& pixels, const juce::Rectangle<int>& area)
+    {
+        const auto clipped = area.getIntersection({ width, height });
+
+        for (int y = clipped.getY(); y < clipped.getBottom(); y++)
+        {
+            for (int x = clipped.getX(); x < clipped.getRight(); x++)
+            {
+                setPixel(x, y, pixels[x][y]);
+            }
+        }
+    }
+
+    bool getPixel(int x, int y) const noexcept
+    {
+        return ((bits[getWordIndex(x, y)] >> (x % 64)) & 1) != 0;
+    }
+
+    void setPixel(int x, int y, bool on) noexcept
+    {
+        auto& word = bits[getWordIndex(x, y)];
+        const auto mask = uint64_t(1) << (x % 64);
+
+        if (((word & mask) != 0) != on)
+        {
+            word ^= mask;
+            dirtyTiles[static_cast<size_t>(y / tileSize)] |= uint32_t(1) << (x / tileSize);
+        }
+    }
+
+    // The 8 pixels of a tile row, leftmost in bit 0
+    uint8_t getTileRowBits(int column, int y) const noexcept
+    {
+        const auto x = column * tileSize;
+        return static_cast<uint8_t>(bits[getWordIndex(x, y)] >> (x % 64));
+    }
+
+    bool isDirty() const noexcept;
+    bool isTileDirty(int column, int row) const noexcept { return ((dirtyTiles[static_cast<size_t>(row)] >> column) & 1) != 0; }
+    void markAllDirty() noexcept;
+    void clearDirty() noexcept { dirtyTiles.fill(0); }
+
+    // In LCD pixels, clipped to the LCD
+    static juce::Rectangle<int> getTileArea(int column, int row);
+
+private:
+    static constexpr int wordsPerRow = (width + 63) / 64;
+
+    static size_t getWordIndex(int x, int y) noexcept
+    {
+        return static_cast<size_t>(y * wordsPerRow + x / 64);
+    }
+
+    static_assert(tileColumns <= 32, "A row of tiles has to fit in a dirty word");
+    static_assert(64 % tileSize == 0, "A tile row has to be in a single word");
+
+    std::array<uint64_t, static_cast<size_t>(height * wordsPerRow)> bits {};
+    std::array<uint32_t, static_cast<size_t>(tileRows)> dirtyTiles {};
+};
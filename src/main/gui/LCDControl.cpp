@@ -9,15 +9,18 @@
 
 #include <gui/BasicStructs.hpp>
 
+#include <cstring>
+
 using namespace mpc::lcdgui;
 using namespace mpc::lcdgui::screens;
 
 LCDControl::LCDControl(mpc::Mpc& _mpc)
 	: mpc (_mpc), ls (_mpc.getLayeredScreen())
 {
-	lcd = juce::Image(juce::Image::RGB, 496, 120, true);
+	lcd = juce::Image(juce::Image::ARGB, 496, 120, true);
 	auto othersScreen = mpc.screens->get<OthersScreen>("others");
 	othersScreen->addObserver(this);
+	updatePalette();
 }
 
 void LCDControl::update(moduru::observer::Observable*, nonstd::any msg)
@@ -26,74 +29,200 @@ void LCDControl::update(moduru::observer::Observable*, nonstd::any msg)
 
 	if (message == "contrast")
 	{
-		ls->getFocusedLayer()->SetDirty(); // Could be done less invasively by just redrawing the current pixels of the LCD screens, but with updated colors
+		// Only the colours change, so the last rendered pixels are
+		// recoloured without redrawing the screen.
+		updatePalette();
+		bitplane.markAllDirty();
+		rasterizeDirtyTiles();
 		repaint();
+
+		if (auxWindow != nullptr)
+		{
+			auxWindow->setBackgroundColour(offColour);
+		}
 	}
 }
 
-void LCDControl::drawPixelsToImg()
+void LCDControl::updatePalette()
 {
-	auto pixels = ls->getPixels();
-	
 	auto othersScreen = mpc.screens->get<OthersScreen>("others");
 	auto contrast = othersScreen->getContrast();
 
-  juce::Colour c;
-	
-	auto halfOn = Constants::LCD_HALF_ON.darker(static_cast<float>(contrast * 0.02));
-  auto on = Constants::LCD_ON.darker(static_cast<float>(contrast * 0.02));
-	auto off = Constants::LCD_OFF.brighter(static_cast<float>(contrast * 0.01428));
+	auto toNative = [](const juce::Colour& c) { return c.getPixelARGB().getNativeARGB(); };
 
-    if (isAux) dirtyRect = juce::Rectangle<int>(248, 60);
+	offColour = Constants::LCD_OFF.brighter(static_cast<float>(contrast * 0.01428));
 
-	const auto rectX = dirtyRect.getX();
-	const auto rectY = dirtyRect.getY();
-	const auto rectRight = dirtyRect.getRight();
-	const auto rectBottom = dirtyRect.getBottom();
+	const auto halfOn = toNative(Constants::LCD_HALF_ON.darker(static_cast<float>(contrast * 0.02)));
+	const auto on = toNative(Constants::LCD_ON.darker(static_cast<float>(contrast * 0.02)));
+	const auto off = toNative(offColour);
+
+	// An LCD pixel is 2x2 image pixels. A lit one has its top left in the
+	// full on colour and the rest half on.
+	pixelExpansions[0] = { { off, off }, { off, off } };
+	pixelExpansions[1] = { { on, halfOn }, { halfOn, halfOn } };
+}
+
+juce::RectangleList<int> LCDControl::drawPixelsToImg()
+{
+	auto pixels = ls->getPixels();
 
-	for (int x = rectX; x < rectRight; x++)
+	// Narrows the dirty area down to the tiles in which a pixel flipped
+	bitplane.copyFrom(*pixels, dirtyRect);
+	dirtyRect = juce::Rectangle<int>();
+
+	return rasterizeDirtyTiles();
+}
+
+juce::RectangleList<int> LCDControl::rasterizeDirtyTiles()
+{
+	juce::RectangleList<int> changedArea;
+
+	for (int row = 0; row < LCDBitplane::tileRows; row++)
 	{
-		for (int y = rectY; y < rectBottom; y++)
+		for (int column = 0; column < LCDBitplane::tileColumns; column++)
 		{
-			const auto x_x2 = x * 2;
-			const auto y_x2 = y * 2;
-			
-			if ((*pixels)[x][y])
+			if (!bitplane.isTileDirty(column, row))
 			{
-				c = halfOn;
-				lcd.setPixelAt(x_x2, y_x2, on);
+				continue;
 			}
-			else {
-				c = off;
-				lcd.setPixelAt(x_x2, y_x2, c);
+
+			const auto tile = LCDBitplane::getTileArea(column, row);
+			const auto imageArea = tile * (isAux ? auxScale : 2);
+
+			juce::Image::BitmapData data(lcd, imageArea.getX(), imageArea.getY(), imageArea.getWidth(), imageArea.getHeight(), juce::Image::BitmapData::writeOnly);
+
+			if (isAux)
+			{
+				rasterizeScaledTile(data, tile);
+				changedArea.addWithoutMerging(imageArea);
+				continue;
+			}
+
+			jassert(data.pixelStride == sizeof(juce::uint32));
+
+			for (int y = 0; y < tile.getHeight(); y++)
+			{
+				const auto rowBits = bitplane.getTileRowBits(column, tile.getY() + y);
+				auto top = reinterpret_cast<juce::uint32*>(data.getLinePointer(y * 2));
+				auto bottom = reinterpret_cast<juce::uint32*>(data.getLinePointer(y * 2 + 1));
+
+				for (int x = 0; x < tile.getWidth(); x++)
+				{
+					const auto& expansion = pixelExpansions[(rowBits >> x) & 1];
+					std::memcpy(top + x * 2, expansion.top, sizeof(expansion.top));
+					std::memcpy(bottom + x * 2, expansion.bottom, sizeof(expansion.bottom));
+				}
+			}
+
+			changedArea.addWithoutMerging(imageArea);
+		}
+	}
+
+	bitplane.clearDirty();
+	changedArea.consolidate();
+	return changedArea;
+}
+
+// Like the 2x2 expansion, a lit pixel has its top left quarter in the full
+// on colour and the rest half on. Each band of rows is written once and
+// copied to the other rows of the band.
+void LCDControl::rasterizeScaledTile(juce::Image::BitmapData& data, const juce::Rectangle<int>& tile)
+{
+	const auto split = std::max(1, auxScale / 2);
+	const auto lineBytes = static_cast<size_t>(data.width * data.pixelStride);
+
+	const auto off = pixelExpansions[0].top[0];
+	const auto on = pixelExpansions[1].top[0];
+	const auto halfOn = pixelExpansions[1].top[1];
+
+	jassert(data.pixelStride == sizeof(juce::uint32));
+
+	for (int y = 0; y < tile.getHeight(); y++)
+	{
+		const auto rowBits = bitplane.getTileRowBits(tile.getX() / LCDBitplane::tileSize, tile.getY() + y);
+		const auto topLine = y * auxScale;
+		const auto bottomLine = topLine + split;
+		const auto hasBottomBand = bottomLine < topLine + auxScale;
+
+		auto top = reinterpret_cast<juce::uint32*>(data.getLinePointer(topLine));
+		auto bottom = hasBottomBand ? reinterpret_cast<juce::uint32*>(data.getLinePointer(bottomLine)) : nullptr;
+
+		for (int x = 0; x < tile.getWidth(); x++)
+		{
+			const auto lit = ((rowBits >> x) & 1) != 0;
+
+			for (int i = 0; i < auxScale; i++)
+			{
+				const auto imageX = x * auxScale + i;
+				top[imageX] = lit ? (i < split ? on : halfOn) : off;
+
+				if (hasBottomBand)
+				{
+					bottom[imageX] = lit ? halfOn : off;
+				}
+			}
+		}
+
+		for (int line = topLine + 1; line < topLine + auxScale; line++)
+		{
+			if (line != bottomLine)
+			{
+				std::memcpy(data.getLinePointer(line), data.getLinePointer(line < bottomLine ? topLine : bottomLine), lineBytes);
 			}
-					
-			lcd.setPixelAt(x_x2 + 1, y_x2, c);
-			lcd.setPixelAt(x_x2 + 1, y_x2 + 1, c);
-			lcd.setPixelAt(x_x2, y_x2 + 1, c);
 		}
 	}
-	dirtyRect = juce::Rectangle<int>();
 }
 
-bool LCDControl::auxNeedsToUpdate = false;
+void LCDControl::updateAuxScale()
+{
+	const auto scale = std::max(1, std::min(getWidth() / 248, getHeight() / 60));
 
+	if (scale == auxScale)
+	{
+		return;
+	}
+
+	auxScale = scale;
+	lcd = juce::Image(juce::Image::ARGB, 248 * auxScale, 60 * auxScale, true);
+	bitplane.markAllDirty();
+	rasterizeDirtyTiles();
+	repaint();
+}
+
+juce::Point<int> LCDControl::getAuxImagePosition() const
+{
+	return { (getWidth() - lcd.getWidth()) / 2, (getHeight() - lcd.getHeight()) / 2 };
+}
+
+void LCDControl::redrawArea(const juce::Rectangle<int>& area)
+{
+	dirtyRect = dirtyRect.getUnion(area);
+
+	const auto imagePosition = isAux ? getAuxImagePosition() : juce::Point<int>();
+
+	for (auto& changedArea : drawPixelsToImg())
+	{
+		repaint(changedArea + imagePosition);
+	}
+}
+
+// The aux view has no timer of its own. It is handed the area that changed
+// in the layered screen of the same instance.
 void LCDControl::checkLsDirty()
 {
-    if (isAux && auxNeedsToUpdate)
-    {
-        drawPixelsToImg();
-        repaint();
-        auxNeedsToUpdate = false;
-    }
-	else if (!isAux && ls->IsDirty())
+	if (isAux || !ls->IsDirty())
 	{
-		auto dirtyArea = ls->getDirtyArea();
-		dirtyRect = juce::Rectangle<int>(dirtyArea.L, dirtyArea.T, dirtyArea.W(), dirtyArea.H());
-		ls->Draw();
-		drawPixelsToImg();
-		repaint();
-        auxNeedsToUpdate = true;
+		return;
+	}
+
+	auto dirtyArea = ls->getDirtyArea();
+	const juce::Rectangle<int> area(dirtyArea.L, dirtyArea.T, dirtyArea.W(), dirtyArea.H());
+	ls->Draw();
+	redrawArea(area);
+
+	if (auxView != nullptr)
+	{
+		auxView->redrawArea(area);
 	}
 }
 
@@ -106,7 +235,16 @@ void LCDControl::paint(juce::Graphics& g)
 {
     if (isAux)
     {
-        g.drawImage(lcd, getLocalBounds().toFloat());
+        // The component is opaque, so the margin around the image is
+        // filled first and the image is blitted as is.
+        const auto position = getAuxImagePosition();
+
+        g.saveState();
+        g.excludeClipRegion(lcd.getBounds() + position);
+        g.fillAll(offColour);
+        g.restoreState();
+
+        g.drawImageAt(lcd, position.x, position.y);
     }
 	else
     {
@@ -127,6 +265,7 @@ void LCDControl::mouseDoubleClick (const juce::MouseEvent&)
         contentComponent->keyboard->setAuxParent(nullptr);
         delete auxWindow;
         auxWindow = nullptr;
+        auxView = nullptr;
     }
     else
     {
@@ -149,6 +288,7 @@ void LCDControl::mouseDoubleClick (const juce::MouseEvent&)
         private: LCDControl* parent; Keyboard* keyboard;
             void resized() override {
                 setBounds(margin / 2, margin / 2, getParentWidth() - margin, getParentHeight() - margin);
+                updateAuxScale();
             }
             void mouseDoubleClick(const juce::MouseEvent&) override {
                 keyboard->setAuxParent(nullptr);
@@ -158,10 +298,13 @@ void LCDControl::mouseDoubleClick (const juce::MouseEvent&)
 
         auto auxLcd = new AuxLCD(mpc, this, contentComponent->keyboard);
         auxLcd->isAux = true;
+        // It draws its own cached image at the right scale
+        auxLcd->setBufferedToImage(false);
+        auxLcd->setOpaque(true);
         auxWindow->setContentOwned(auxLcd, false);
-        auxWindow->setBackgroundColour(Constants::LCD_OFF);
-        auxLcd->drawPixelsToImg();
-        auxLcd->startTimer(25);
+        auxWindow->setBackgroundColour(offColour);
+        auxLcd->redrawArea(juce::Rectangle<int>(248, 60));
+        auxView = auxLcd;
     }
 }
 
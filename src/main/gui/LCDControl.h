@@ -1,5 +1,6 @@
 #pragma once
 #include "VmpcComponent.hpp"
+#include "LCDBitplane.h"
 
 #include <observer/Observer.hpp>
 
@@ -21,18 +22,43 @@ class LCDControl
 private:
     bool isAux = false;
     juce::ResizableWindow* auxWindow = nullptr;
+    // Owned by auxWindow
+    LCDControl* auxView = nullptr;
     mpc::Mpc& mpc;
 	std::shared_ptr<mpc::lcdgui::LayeredScreen> ls;
 	juce::Image lcd;
     juce::Rectangle<int> dirtyRect;
-    static bool auxNeedsToUpdate;
+    LCDBitplane bitplane;
+
+    // The 2x2 block of native ARGB pixels for an unlit and a lit LCD pixel
+    struct PixelExpansion
+    {
+        juce::uint32 top[2];
+        juce::uint32 bottom[2];
+    };
+
+    PixelExpansion pixelExpansions[2];
+    // Fills the aux view around the image
+    juce::Colour offColour;
+    void updatePalette();
+    juce::RectangleList<int> rasterizeDirtyTiles();
+
+    // The aux view keeps lcd at a whole multiple of the LCD size that fits
+    // its bounds, so it can be blitted without rescaling.
+    int auxScale = 0;
+    void rasterizeScaledTile(juce::Image::BitmapData& data, const juce::Rectangle<int>& tile);
+    juce::Point<int> getAuxImagePosition() const;
 
 protected:
-    void resetAuxWindow() { if (auxWindow != nullptr) { auxWindow->removeFromDesktop(); delete auxWindow; auxWindow = nullptr;}}
+    void updateAuxScale();
+    void resetAuxWindow() { if (auxWindow != nullptr) { auxWindow->removeFromDesktop(); delete auxWindow; auxWindow = nullptr; auxView = nullptr;}}
     
 public:
 	void checkLsDirty();
-	void drawPixelsToImg();
+	// Returns the area of the image that changed
+	juce::RectangleList<int> drawPixelsToImg();
+	// Re-rasterizes and repaints what changed in an area of the LCD
+	void redrawArea(const juce::Rectangle<int>& area);
 	void paint(juce::Graphics& g) override;
 	void timerCallback() override;
     void mouseDoubleClick (const juce::MouseEvent&) override;
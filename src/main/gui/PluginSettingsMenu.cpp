@@ -0,0 +1,62 @@
+#include "PluginSettingsMenu.h"
+
+#include "../PluginProcessor.h"
+
+void PluginSettingsMenu::show(VmpcAudioProcessor& processor, juce::Component& owner)
+{
+    juce::PopupMenu compression;
+
+    auto addCompression = [&](const juce::String& name, SampleCodec::Level level) {
+        compression.addItem(name, true, processor.getStateCompression() == level, [&processor, level]() {
+            processor.setStateCompression(level);
+        });
+    };
+
+    addCompression("Fast", SampleCodec::Level::Fast);
+    addCompression("Small (slower saving)", SampleCodec::Level::Small);
+    addCompression("Off", SampleCodec::Level::None);
+
+    juce::PopupMenu storage;
+
+    auto addStorage = [&](const juce::String& name, VmpcAudioProcessor::SampleStorage sampleStorage) {
+        storage.addItem(name, true, processor.getSampleStorage() == sampleStorage, [&processor, sampleStorage]() {
+            processor.setSampleStorage(sampleStorage);
+        });
+    };
+
+    addStorage("Embedded", VmpcAudioProcessor::SampleStorage::Embedded);
+    addStorage("Referenced (SND files in the stores directory)", VmpcAudioProcessor::SampleStorage::Referenced);
+
+    using MidiOutBMode = VmpcAudioProcessor::MidiOutBMode;
+
+    juce::PopupMenu channelOffsets;
+
+    for (int offset = 1; offset <= 15; offset++)
+    {
+        const auto ticked = processor.getMidiOutBMode() == MidiOutBMode::ChannelOffset && processor.getMidiOutBChannelOffset() == offset;
+
+        channelOffsets.addItem("+" + juce::String(offset), true, ticked, [&processor, offset]() {
+            processor.setMidiOutBChannelOffset(offset);
+            processor.setMidiOutBMode(MidiOutBMode::ChannelOffset);
+        });
+    }
+
+    juce::PopupMenu midiOutB;
+    midiOutB.addItem("Off", true, processor.getMidiOutBMode() == MidiOutBMode::Off, [&processor]() {
+        processor.setMidiOutBMode(MidiOutBMode::Off);
+    });
+    midiOutB.addSubMenu("Merged, channels moved up", channelOffsets, true, nullptr,
+                        processor.getMidiOutBMode() == MidiOutBMode::ChannelOffset);
+    midiOutB.addItem("Merged as SysEx", true, processor.getMidiOutBMode() == MidiOutBMode::SysExTagged, [&processor]() {
+        processor.setMidiOutBMode(MidiOutBMode::SysExTagged);
+    });
+
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Saved projects");
+    menu.addSubMenu("Sample compression", compression);
+    menu.addSubMenu("Sample storage", storage);
+    menu.addSectionHeader("MIDI");
+    menu.addSubMenu("MIDI OUT B", midiOutB);
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withDeletionCheck(owner));
+}
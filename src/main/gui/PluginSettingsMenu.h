@@ -0,0 +1,14 @@
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+
+class VmpcAudioProcessor;
+
+// The settings of the plugin that aren't part of the MPC itself. Shown from
+// the gear button when running as a plugin, the standalone app shows its
+// audio and MIDI settings there instead.
+namespace PluginSettingsMenu
+{
+    // The menu closes if owner is deleted
+    void show(VmpcAudioProcessor&, juce::Component& owner);
+}
@@ -0,0 +1,49 @@
+#include "MidiEventBatch.h"
+
+void MidiEventBatch::fill(const juce::MidiBuffer& midiMessages)
+{
+    size = 0;
+    droppedCount = 0;
+
+    for (const auto meta : midiMessages)
+    {
+        const auto data = meta.data;
+        const auto numBytes = meta.numBytes;
+
+        if (numBytes <= 0)
+        {
+            continue;
+        }
+
+        const auto status = data[0];
+
+        // MIDI Machine Control: F0 7F <device> 06 <command> F7
+        if (status == 0xF0)
+        {
+            if (numBytes >= 6 && data[1] == 0x7F && data[3] == 0x06)
+            {
+                add(meta.samplePosition, machineControl, data[4], 0);
+            }
+
+            continue;
+        }
+
+        if (status < 0x80 || status >= 0xF0)
+        {
+            continue;
+        }
+
+        add(meta.samplePosition, status, numBytes > 1 ? data[1] : 0, numBytes > 2 ? data[2] : 0);
+    }
+}
+
+void MidiEventBatch::add(int32_t timestamp, uint8_t status, uint8_t data1, uint8_t data2)
+{
+    if (size == capacity)
+    {
+        droppedCount++;
+        return;
+    }
+
+    events[static_cast<size_t>(size++)] = { timestamp, status, data1, data2 };
+}
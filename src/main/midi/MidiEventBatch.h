@@ -0,0 +1,50 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <array>
+#include <cstdint>
+
+// The MIDI input of one audio block, as a flat array of compact events.
+//
+// fill() makes one pass over the host's MidiBuffer and keeps what the MPC
+// engine understands: channel voice messages and MIDI Machine Control
+// commands, the latter stored with status 0xF0 and the MMC command in data1.
+// Every event is kept in order, including every step of controller, pressure
+// and pitch bend sweeps, since NRPN, data entry, bank select and controller
+// buttons depend on each value.
+//
+// Storage is fixed, so filling never allocates. Events past the capacity
+// are dropped and counted.
+class MidiEventBatch
+{
+public:
+    struct Event
+    {
+        int32_t timestamp;
+        uint8_t status;
+        uint8_t data1;
+        uint8_t data2;
+    };
+
+    static constexpr int capacity = 2048;
+    static constexpr uint8_t machineControl = 0xF0;
+
+    void fill(const juce::MidiBuffer& midiMessages);
+
+    const Event* begin() const noexcept { return events.data(); }
+    const Event* end() const noexcept { return events.data() + size; }
+
+    bool isEmpty() const noexcept { return size == 0; }
+
+    // Events dropped because the block had more than capacity of them,
+    // since the last call to fill().
+    int getDroppedCount() const noexcept { return droppedCount; }
+
+private:
+    void add(int32_t timestamp, uint8_t status, uint8_t data1, uint8_t data2);
+
+    std::array<Event, capacity> events;
+    int size = 0;
+    int droppedCount = 0;
+};
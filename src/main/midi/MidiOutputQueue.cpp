@@ -0,0 +1,28 @@
+#include "MidiOutputQueue.h"
+
+#include <cstring>
+
+void MidiOutputQueue::add(int32_t samplePosition, const uint8_t* data, int numBytes) noexcept
+{
+    jassert(numBytes > 0 && numBytes <= maxEventSize);
+
+    if (size == capacity || numBytes <= 0 || numBytes > maxEventSize)
+    {
+        droppedCount++;
+        return;
+    }
+
+    auto& event = events[static_cast<size_t>(size++)];
+    event.samplePosition = samplePosition;
+    event.numBytes = static_cast<uint8_t>(numBytes);
+    std::memcpy(event.bytes, data, static_cast<size_t>(numBytes));
+}
+
+void MidiOutputQueue::writeTo(juce::MidiBuffer& midiMessages) const
+{
+    for (int i = 0; i < size; i++)
+    {
+        auto& event = events[static_cast<size_t>(i)];
+        midiMessages.addEvent(event.bytes, event.numBytes, event.samplePosition);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <array>
+#include <cstdint>
+
+// The MIDI output of one audio block, as raw bytes in fixed storage.
+//
+// The MPC's output messages are translated into this queue while the block
+// renders and written into a MidiBuffer once it is done, so the audio
+// thread neither allocates nor builds juce::MidiMessage objects for them.
+// Events past the capacity are dropped and counted.
+class MidiOutputQueue
+{
+public:
+    struct Event
+    {
+        int32_t samplePosition;
+        uint8_t numBytes;
+        uint8_t bytes[7];
+    };
+
+    static constexpr int capacity = 1024;
+    static constexpr int maxEventSize = 7;
+
+    void clear() noexcept
+    {
+        size = 0;
+        droppedCount = 0;
+    }
+
+    void add(int32_t samplePosition, const uint8_t* data, int numBytes) noexcept;
+
+    // Adds every event to the buffer, which does not allocate as long as
+    // the buffer has room for them.
+    void writeTo(juce::MidiBuffer& midiMessages) const;
+
+    const Event* begin() const noexcept { return events.data(); }
+    const Event* end() const noexcept { return events.data() + size; }
+
+    bool isEmpty() const noexcept { return size == 0; }
+    int getDroppedCount() const noexcept { return droppedCount; }
+
+private:
+    std::array<Event, capacity> events;
+    int size = 0;
+    int droppedCount = 0;
+};
@@ -0,0 +1,89 @@
+#include "MidiOutputSender.h"
+
+#include <cstring>
+
+MidiOutputSender::MidiOutputSender()
+    : juce::Thread("VMPC2000XL MIDI OUT B")
+{
+}
+
+MidiOutputSender::~MidiOutputSender()
+{
+    stopThread(-1);
+}
+
+void MidiOutputSender::setOutput(juce::MidiOutput* newOutput)
+{
+    {
+        const juce::ScopedLock sl(outputLock);
+        output = newOutput;
+    }
+
+    outputIsSet.store(newOutput != nullptr);
+
+    if (newOutput != nullptr)
+    {
+        startThread();
+    }
+}
+
+void MidiOutputSender::add(const MidiOutputQueue& queue, double blockStartMs, double sampleRate) noexcept
+{
+    const auto msPerSample = sampleRate > 0.0 ? 1000.0 / sampleRate : 0.0;
+    const auto count = static_cast<int>(queue.end() - queue.begin());
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(count, start1, size1, start2, size2);
+
+    auto event = queue.begin();
+
+    auto copy = [&](int start, int size) {
+        for (int i = start; i < start + size; i++, event++)
+        {
+            auto& timedEvent = events[static_cast<size_t>(i)];
+            timedEvent.timeMs = blockStartMs + event->samplePosition * msPerSample;
+            timedEvent.numBytes = event->numBytes;
+            std::memcpy(timedEvent.bytes, event->bytes, event->numBytes);
+        }
+    };
+
+    copy(start1, size1);
+    copy(start2, size2);
+    fifo.finishedWrite(size1 + size2);
+}
+
+void MidiOutputSender::run()
+{
+    while (!threadShouldExit())
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+        {
+            wait(1);
+            continue;
+        }
+
+        const auto& event = events[static_cast<size_t>(start1)];
+        const auto waitMs = event.timeMs - juce::Time::getMillisecondCounterHiRes();
+
+        // Events are queued in order, so nothing else is due earlier
+        if (waitMs >= 1.0)
+        {
+            wait(static_cast<int>(waitMs));
+            continue;
+        }
+
+        {
+            const juce::ScopedLock sl(outputLock);
+
+            if (output != nullptr)
+            {
+                output->sendMessageNow(juce::MidiMessage(event.bytes, event.numBytes));
+            }
+        }
+
+        fifo.finishedRead(1);
+    }
+}
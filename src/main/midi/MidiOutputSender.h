@@ -0,0 +1,49 @@
+#pragma once
+
+#include "MidiOutputQueue.h"
+
+#include <juce_audio_devices/juce_audio_devices.h>
+
+#include <array>
+#include <atomic>
+
+// Sends the MIDI output of the audio thread to a MIDI device.
+//
+// add() copies the events of a block into a fixed ring buffer with the time
+// they are due, which neither allocates nor locks. A dedicated thread takes
+// them out in order and sends each with sendMessageNow once it is due.
+// Events that don't fit into the ring buffer are dropped.
+class MidiOutputSender : private juce::Thread
+{
+public:
+    MidiOutputSender();
+    ~MidiOutputSender() override;
+
+    // The output stays owned by the caller, who must keep it open until it
+    // is replaced. Once this returns, the old output is no longer used.
+    void setOutput(juce::MidiOutput* output);
+    bool hasOutput() const noexcept { return outputIsSet.load(); }
+
+    // Called on the audio thread. blockStartMs is the
+    // getMillisecondCounterHiRes() time of the first sample of the block.
+    void add(const MidiOutputQueue& queue, double blockStartMs, double sampleRate) noexcept;
+
+private:
+    struct TimedEvent
+    {
+        double timeMs;
+        uint8_t numBytes;
+        uint8_t bytes[MidiOutputQueue::maxEventSize];
+    };
+
+    static constexpr int capacity = 4 * MidiOutputQueue::capacity;
+
+    void run() override;
+
+    juce::AbstractFifo fifo { capacity };
+    std::array<TimedEvent, capacity> events;
+
+    juce::CriticalSection outputLock;
+    juce::MidiOutput* output = nullptr;
+    std::atomic<bool> outputIsSet { false };
+};
@@ -0,0 +1,340 @@
+#include "AutosaveJournal.h"
+#include "ContentHash.h"
+#include "SampleCodec.h"
+#include "SoundChunks.h"
+
+#include <Logger.hpp>
+
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace StateChunks;
+
+namespace
+{
+    constexpr uint32_t recordMagic = fourCC("VMPJ");
+    constexpr size_t recordHeaderSize = 24;
+    constexpr size_t checksumSize = 8;
+
+    // Rewrite the journal once it is this much larger than after the last
+    // rewrite, so a long session doesn't keep every intermediate state.
+    constexpr juce::int64 compactionSlack = 32 * 1024 * 1024;
+
+    uint32_t readUInt32(const char* src)
+    {
+        uint32_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return juce::ByteOrder::swapIfBigEndian(value);
+    }
+
+    uint64_t readUInt64(const char* src)
+    {
+        uint64_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return juce::ByteOrder::swapIfBigEndian(value);
+    }
+
+    void writeRecord(juce::OutputStream& out, uint32_t type, Encoding encoding, const char* data, size_t size)
+    {
+        char header[recordHeaderSize];
+        auto put32 = [&](size_t offset, uint32_t value) {
+            value = juce::ByteOrder::swapIfBigEndian(value);
+            std::memcpy(header + offset, &value, sizeof(value));
+        };
+
+        put32(0, recordMagic);
+        put32(4, type);
+        put32(8, static_cast<uint32_t>(encoding));
+        put32(12, 0);
+
+        auto size64 = juce::ByteOrder::swapIfBigEndian(static_cast<uint64_t>(size));
+        std::memcpy(header + 16, &size64, sizeof(size64));
+
+        const auto checksum = ContentHash::hash(data, size, ContentHash::hash(header, recordHeaderSize));
+
+        out.write(header, recordHeaderSize);
+        out.write(data, size);
+        out.writeInt64(static_cast<juce::int64>(checksum));
+    }
+
+    // Sample payloads are compressed here rather than on the message thread
+    void writeBatchRecord(juce::OutputStream& out, const AutosaveJournal::Record& record)
+    {
+        const auto& data = record.data;
+
+        if (record.type == SoundChunks::payload && data.size() > sizeof(uint64_t))
+        {
+            auto encoded = SampleCodec::encode(data.data() + sizeof(uint64_t), data.size() - sizeof(uint64_t), SampleCodec::Level::Fast);
+
+            if (encoded.size() + sizeof(uint64_t) < data.size())
+            {
+                encoded.insert(encoded.begin(), data.begin(), data.begin() + sizeof(uint64_t));
+                writeRecord(out, record.type, Encoding::LpcRice, encoded.data(), encoded.size());
+                return;
+            }
+        }
+
+        writeRecord(out, record.type, Encoding::Raw, data.data(), data.size());
+    }
+}
+
+AutosaveJournal::AutosaveJournal(const juce::File& fileToUse, juce::int64 validSizeToUse)
+    : juce::Thread("VMPC2000XL autosave"), file(fileToUse), validSize(validSizeToUse), compactedSize(validSizeToUse)
+{
+    startThread();
+}
+
+AutosaveJournal::~AutosaveJournal()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(-1);
+
+    writePending();
+}
+
+void AutosaveJournal::append(BatchSource createBatch)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        pending.push_back(std::move(createBatch));
+    }
+
+    notify();
+}
+
+void AutosaveJournal::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        writePending();
+    }
+}
+
+bool AutosaveJournal::openStream()
+{
+    if (stream != nullptr)
+    {
+        return true;
+    }
+
+    stream = std::make_unique<juce::FileOutputStream>(file);
+
+    if (stream->failedToOpen())
+    {
+        moduru::Logger::l.log("Failed to open autosave journal " + file.getFullPathName().toStdString() + "\n");
+        stream.reset();
+        return false;
+    }
+
+    // Cut off a batch that was torn by a crash, so new batches aren't
+    // appended behind a record that replay can't get past.
+    if (stream->getPosition() > validSize)
+    {
+        stream->setPosition(validSize);
+        stream->truncate();
+    }
+
+    return true;
+}
+
+void AutosaveJournal::writePending()
+{
+    std::deque<BatchSource> sources;
+
+    {
+        const juce::ScopedLock sl(lock);
+        sources.swap(pending);
+    }
+
+    if (sources.empty() || !openStream())
+    {
+        return;
+    }
+
+    for (auto& createBatch : sources)
+    {
+        for (auto& record : createBatch())
+        {
+            writeBatchRecord(*stream, record);
+        }
+
+        writeRecord(*stream, commit, Encoding::Raw, nullptr, 0);
+        stream->flush();
+    }
+
+    validSize = stream->getPosition();
+    compactIfNeeded();
+}
+
+void AutosaveJournal::compactIfNeeded()
+{
+    if (validSize <= compactedSize * 2 + compactionSlack)
+    {
+        return;
+    }
+
+    stream.reset();
+
+    juce::int64 recoveredSize;
+    auto state = recover(file, recoveredSize);
+    StateChunkReader reader(state.getData(), state.getSize());
+
+    if (!reader.isValid())
+    {
+        return;
+    }
+
+    juce::TemporaryFile temp(file);
+
+    {
+        juce::FileOutputStream out(temp.getFile());
+
+        if (out.failedToOpen())
+        {
+            return;
+        }
+
+        for (auto& chunk : reader.getChunks())
+        {
+            writeRecord(out, chunk.type, chunk.encoding, chunk.data, chunk.size);
+        }
+
+        writeRecord(out, commit, Encoding::Raw, nullptr, 0);
+        out.flush();
+        validSize = out.getPosition();
+    }
+
+    if (temp.overwriteTargetFileWithTemporary())
+    {
+        compactedSize = validSize;
+    }
+    else
+    {
+        validSize = file.getSize();
+    }
+}
+
+juce::MemoryBlock AutosaveJournal::recover(const juce::File& file, juce::int64& validSize)
+{
+    validSize = 0;
+    juce::MemoryBlock journal;
+
+    if (!file.existsAsFile() || !file.loadFileAsData(journal))
+    {
+        return {};
+    }
+
+    const auto begin = static_cast<const char*>(journal.getData());
+    const auto end = begin + journal.getSize();
+
+    Chunk aps, all;
+    std::vector<Chunk> references;
+    std::unordered_map<uint64_t, Chunk> payloads;
+
+    struct Committed
+    {
+        Chunk aps, all;
+        std::vector<Chunk> references;
+    };
+
+    std::unique_ptr<Committed> committed;
+
+    for (auto p = begin; static_cast<size_t>(end - p) >= recordHeaderSize + checksumSize;)
+    {
+        const auto size = readUInt64(p + 16);
+
+        if (readUInt32(p) != recordMagic || size > static_cast<size_t>(end - p) - recordHeaderSize - checksumSize)
+        {
+            break;
+        }
+
+        Chunk record;
+        record.type = readUInt32(p + 4);
+        record.encoding = static_cast<Encoding>(readUInt32(p + 8));
+        record.data = p + recordHeaderSize;
+        record.size = static_cast<size_t>(size);
+
+        const auto checksum = ContentHash::hash(record.data, record.size, ContentHash::hash(p, recordHeaderSize));
+
+        if (readUInt64(record.data + record.size) != checksum)
+        {
+            break;
+        }
+
+        p = record.data + record.size + checksumSize;
+
+        uint64_t hash;
+
+        if (record.type == StateChunks::aps)
+        {
+            aps = record;
+        }
+        else if (record.type == StateChunks::all)
+        {
+            all = record;
+        }
+        else if (record.type == SoundChunks::reference)
+        {
+            references.push_back(record);
+        }
+        else if (record.type == SoundChunks::payload && SoundChunks::getPayloadHash(record, hash))
+        {
+            payloads[hash] = record;
+        }
+        else if (record.type == commit)
+        {
+            committed = std::make_unique<Committed>(Committed { aps, all, std::move(references) });
+            references.clear();
+            validSize = p - begin;
+        }
+    }
+
+    if (committed == nullptr)
+    {
+        return {};
+    }
+
+    juce::MemoryBlock state;
+    StateChunkWriter writer(state, 2 + committed->references.size() * 2, static_cast<size_t>(validSize));
+
+    if (committed->aps.data != nullptr)
+    {
+        writer.addChunk(StateChunks::aps, committed->aps.data, committed->aps.size, committed->aps.encoding);
+    }
+
+    std::unordered_set<uint64_t> writtenPayloads;
+
+    for (auto& reference : committed->references)
+    {
+        SoundChunks::SoundProperties properties;
+
+        if (!SoundChunks::parseReference(reference, properties) || writtenPayloads.count(properties.hash) > 0)
+        {
+            continue;
+        }
+
+        auto it = payloads.find(properties.hash);
+
+        if (it != payloads.end())
+        {
+            writer.addChunk(SoundChunks::payload, it->second.data, it->second.size, it->second.encoding);
+            writtenPayloads.insert(properties.hash);
+        }
+    }
+
+    for (auto& reference : committed->references)
+    {
+        writer.addChunk(SoundChunks::reference, reference.data, reference.size);
+    }
+
+    if (committed->all.data != nullptr)
+    {
+        writer.addChunk(StateChunks::all, committed->all.data, committed->all.size, committed->all.encoding);
+    }
+
+    writer.finish();
+    return state;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "StateChunks.h"
+
+#include <juce_core/juce_core.h>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+// Append-only crash recovery journal for the standalone app.
+//
+// Every record is a header (magic "VMPJ", type, encoding, reserved, size),
+// the payload and an XXH64 checksum over both. Record types are the chunk
+// types of the plugin state, so a batch of records is the changed part of
+// a state, closed by a CMIT record. Replaying the journal keeps the latest
+// APS and ALL records, every PCM record by hash and the SREF records of the
+// current batch, and takes a copy of that at every commit. Replay stops at
+// the first record that is torn or fails its checksum, so a crash in the
+// middle of a batch falls back to the previous commit.
+//
+// Batches are appended on a background thread. When the journal has grown
+// well past the size of the state it holds, that thread rewrites it to just
+// the last committed state.
+class AutosaveJournal : private juce::Thread
+{
+public:
+    // validSize is the size of the journal up to its last commit, as
+    // reported by recover(). Anything after it is cut off before appending.
+    AutosaveJournal(const juce::File& file, juce::int64 validSize);
+
+    // Appends whatever is still queued before returning.
+    ~AutosaveJournal() override;
+
+    struct Record
+    {
+        uint32_t type;
+        std::vector<char> data;
+    };
+
+    // Called on the journal thread to create a batch, so that whatever
+    // goes into it isn't computed on the caller's thread. PCM records are
+    // expected uncompressed and get compressed there too.
+    using BatchSource = std::function<std::vector<Record>()>;
+
+    // Queues one batch. Sources are called in the order they were queued.
+    void append(BatchSource createBatch);
+
+    // Returns the last committed state as a chunked plugin state, or an
+    // empty block if the journal is missing or holds no complete commit.
+    static juce::MemoryBlock recover(const juce::File& file, juce::int64& validSize);
+
+    static constexpr uint32_t commit = StateChunks::fourCC("CMIT");
+
+private:
+    void run() override;
+    bool openStream();
+    void writePending();
+    void compactIfNeeded();
+
+    const juce::File file;
+    std::unique_ptr<juce::FileOutputStream> stream;
+    juce::int64 validSize;
+    juce::int64 compactedSize;
+
+    juce::CriticalSection lock;
+    std::deque<BatchSource> pending;
+};
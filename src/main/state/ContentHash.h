@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Fast non-cryptographic 64-bit hash for sample data and state sections.
+// Processes 32 bytes per round in four independent lanes, so it runs at
+// memory speed on large sample buffers.
+class ContentHash
+{
+public:
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+};
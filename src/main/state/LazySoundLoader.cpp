@@ -0,0 +1,213 @@
+#include "LazySoundLoader.h"
+#include "WorkerPool.h"
+
+#include <sampler/Sound.hpp>
+#include <file/sndreader/SndReader.hpp>
+
+#include <Logger.hpp>
+
+using namespace mpc::sampler;
+using namespace mpc::file::sndreader;
+
+LazySoundLoader::LazySoundLoader(const juce::CriticalSection& audioCallbackLock)
+    : juce::Thread("VMPC2000XL sound loader"), audioLock(audioCallbackLock)
+{
+}
+
+LazySoundLoader::~LazySoundLoader()
+{
+    cancel();
+}
+
+void LazySoundLoader::add(std::function<std::vector<char>()> loadSnd, std::vector<Target>&& targets)
+{
+    const juce::ScopedLock sl(lock);
+    pending.push_back({ std::move(loadSnd), std::move(targets), {} });
+}
+
+void LazySoundLoader::start()
+{
+    const juce::ScopedLock cl(controlLock);
+    startThread();
+}
+
+void LazySoundLoader::cancel()
+{
+    const juce::ScopedLock cl(controlLock);
+    stopThread(-1);
+    cancelPendingUpdate();
+
+    const juce::ScopedLock sl(lock);
+    pending.clear();
+    decoded.clear();
+}
+
+void LazySoundLoader::finish()
+{
+    const juce::ScopedLock cl(controlLock);
+    stopThread(-1);
+    cancelPendingUpdate();
+
+    std::deque<Job> remaining;
+
+    {
+        const juce::ScopedLock sl(lock);
+        remaining.swap(pending);
+    }
+
+    WorkerPool::parallelFor(remaining.size(), [&](size_t i) { decode(remaining[i]); });
+
+    std::vector<std::string> missingSounds;
+
+    for (auto& job : remaining)
+    {
+        commit(job, missingSounds);
+    }
+
+    if (!missingSounds.empty() && onSampleDataMissing)
+    {
+        onSampleDataMissing(std::move(missingSounds));
+    }
+
+    commitDecoded();
+}
+
+void LazySoundLoader::startFinishing()
+{
+    const juce::ScopedTryLock cl(controlLock);
+
+    if (!cl.isLocked())
+    {
+        return;
+    }
+
+    // Exits right away if nothing is pending
+    startThread();
+}
+
+bool LazySoundLoader::isFinished() const
+{
+    if (isThreadRunning())
+    {
+        return false;
+    }
+
+    const juce::ScopedLock sl(lock);
+    return pending.empty() && decoded.empty();
+}
+
+void LazySoundLoader::run()
+{
+    while (!threadShouldExit())
+    {
+        Job job;
+
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (pending.empty())
+            {
+                return;
+            }
+
+            job = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        decode(job);
+
+        {
+            const juce::ScopedLock sl(lock);
+            decoded.push_back(std::move(job));
+        }
+
+        triggerAsyncUpdate();
+    }
+}
+
+void LazySoundLoader::handleAsyncUpdate()
+{
+    commitDecoded();
+}
+
+void LazySoundLoader::decode(Job& job)
+{
+    auto sndData = job.loadSnd();
+    job.loadSnd = nullptr;
+
+    if (sndData.empty())
+    {
+        moduru::Logger::l.log("Sample data of " + std::to_string(job.targets.size()) + " sound(s) could not be loaded\n");
+        return;
+    }
+
+    std::vector<float> decoded;
+    SndReader sndReader(sndData);
+    sndReader.readData(decoded);
+
+    if (decoded.empty() || job.targets.empty())
+    {
+        return;
+    }
+
+    job.buffers.resize(job.targets.size() - 1, decoded);
+    job.buffers.push_back(std::move(decoded));
+}
+
+void LazySoundLoader::commit(Job& job, std::vector<std::string>& missingSounds)
+{
+    // The placeholders keep their silent buffers
+    if (job.buffers.size() != job.targets.size())
+    {
+        for (auto& target : job.targets)
+        {
+            missingSounds.push_back(target.properties.name);
+        }
+
+        return;
+    }
+
+    std::vector<std::shared_ptr<Sound>> sounds;
+
+    for (auto& target : job.targets)
+    {
+        sounds.push_back(target.sound.lock());
+    }
+
+    const juce::ScopedLock sl(audioLock);
+
+    for (size_t i = 0; i < sounds.size(); i++)
+    {
+        auto& sound = sounds[i];
+
+        if (!sound)
+        {
+            continue;
+        }
+
+        sound->getSampleData()->swap(job.buffers[i]);
+        SoundChunks::clampToLength(*sound);
+    }
+}
+
+void LazySoundLoader::commitDecoded()
+{
+    std::vector<Job> toCommit;
+
+    {
+        const juce::ScopedLock sl(lock);
+        toCommit.swap(decoded);
+    }
+
+    std::vector<std::string> missingSounds;
+
+    for (auto& job : toCommit)
+    {
+        commit(job, missingSounds);
+    }
+
+    if (!missingSounds.empty() && onSampleDataMissing)
+    {
+        onSampleDataMissing(std::move(missingSounds));
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "SoundChunks.h"
+
+#include <juce_events/juce_events.h>
+
+#include <deque>
+#include <functional>
+
+// Streams the sample data of restored sounds in the background.
+//
+// The sounds themselves are registered with the sampler right away, with
+// all their properties and a silent buffer that is as long as their end,
+// so a voice that triggers a sound that isn't resident yet plays silence
+// and the user can edit the sound meanwhile. A background thread loads and
+// decodes the SND files and makes a buffer for every sound that uses them.
+// The buffers are committed on the message thread while holding the audio
+// callback lock. Committing only swaps buffers, so edits made in the
+// meantime are kept, and only pulls start, end and loop point back if the
+// data turns out shorter than they are.
+class LazySoundLoader
+    : private juce::Thread
+    , private juce::AsyncUpdater
+{
+public:
+    // audioCallbackLock is the processor's getCallbackLock()
+    explicit LazySoundLoader(const juce::CriticalSection& audioCallbackLock);
+    ~LazySoundLoader() override;
+
+    struct Target
+    {
+        std::weak_ptr<mpc::sampler::Sound> sound;
+        SoundChunks::SoundProperties properties;
+    };
+
+    // One SND file and all sounds that use its sample data. loadSnd is
+    // called on the loader thread, so it can decompress or read from disk.
+    void add(std::function<std::vector<char>()> loadSnd, std::vector<Target>&& targets);
+
+    void start();
+
+    // Drops everything that isn't resident yet, e.g. because a new state is
+    // about to be restored.
+    void cancel();
+
+    // Decodes and commits everything that is left on the calling thread.
+    // Call before anything reads the sample data of all sounds.
+    void finish();
+
+    // Makes sure the background thread is decoding whatever is left, so a
+    // later finish() has less to do. Never blocks: does nothing while
+    // start(), cancel() or finish() run on another thread.
+    void startFinishing();
+
+    // True when every sound that was added has its sample data.
+    bool isFinished() const;
+
+    // Called with the names of sounds whose sample data couldn't be loaded,
+    // e.g. because the SND file they refer to changed. Called on the thread
+    // that commits, which is the message thread or the caller of finish().
+    std::function<void(std::vector<std::string>)> onSampleDataMissing;
+
+private:
+    struct Job
+    {
+        std::function<std::vector<char>()> loadSnd;
+        std::vector<Target> targets;
+        // One per target, since sample edits happen in place
+        std::vector<std::vector<float>> buffers;
+    };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+
+    static void decode(Job&);
+    void commit(Job&, std::vector<std::string>& missingSounds);
+    void commitDecoded();
+
+    const juce::CriticalSection& audioLock;
+    // Serializes start(), cancel() and finish(), which hosts may trigger
+    // from different threads, e.g. a restore and an offline bounce.
+    juce::CriticalSection controlLock;
+    mutable juce::CriticalSection lock;
+    std::deque<Job> pending;
+    std::vector<Job> decoded;
+};
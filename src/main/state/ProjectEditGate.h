@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lets other threads read the sequencer and the sampler while audio keeps
+// running, without either side taking a lock or waiting on the other.
+//
+// The engine's containers aren't copy-on-write, but the audio thread only
+// changes them while the sequencer records or overdubs, which inserts
+// events into the sequences. Playback and pads only read them or change
+// single values. processBlock publishes whether it may edit the project at
+// its start and end, which costs two atomic operations.
+//
+// A read that would begin while the audio thread may edit the project is
+// refused, and one during which the audio thread started editing is
+// reported as torn. In both cases the caller keeps what it read before.
+// Recording that starts from the UI can't overlap a read on the message
+// thread, which is where the autosaver and most hosts save from.
+class ProjectEditGate
+{
+public:
+    // Call at the start and at the end of processBlock
+    void publishBlock(bool mayEditProject) noexcept
+    {
+        if (mayEditProject)
+        {
+            editCount.fetch_add(1, std::memory_order_release);
+        }
+
+        editing.store(mayEditProject, std::memory_order_release);
+    }
+
+    // Calls readProject() unless the audio thread may be editing the project.
+    // Returns false if it didn't run or its result has to be discarded.
+    template <typename ReadFunction>
+    bool read(ReadFunction&& readProject) const
+    {
+        const auto before = editCount.load(std::memory_order_acquire);
+
+        if (editing.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        readProject();
+
+        return !editing.load(std::memory_order_acquire) && editCount.load(std::memory_order_acquire) == before;
+    }
+
+private:
+    std::atomic<bool> editing { false };
+    std::atomic<uint64_t> editCount { 0 };
+};
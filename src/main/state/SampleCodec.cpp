@@ -0,0 +1,523 @@
+#include "SampleCodec.h"
+
+#include <juce_core/juce_core.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t formatVersion = 1;
+    constexpr size_t blockSize = 4096;
+    constexpr size_t partitionSize = 256;
+    constexpr int maxOrder = 4;
+    constexpr int maxRiceParameter = 28;
+
+    // Quotients from this value on are escaped and followed by the raw residual
+    constexpr int escapeQuotient = 24;
+
+    inline int countLeadingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        return _BitScanReverse64(&index, value) ? 63 - static_cast<int>(index) : 64;
+#else
+        return value == 0 ? 64 : __builtin_clzll(value);
+#endif
+    }
+
+    inline uint32_t zigzag(int32_t value)
+    {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+
+    inline int32_t unzigzag(uint32_t value)
+    {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+
+    inline int32_t predict(const int32_t* x, int order)
+    {
+        switch (order)
+        {
+            case 1: return x[-1];
+            case 2: return 2 * x[-1] - x[-2];
+            case 3: return 3 * x[-1] - 3 * x[-2] + x[-3];
+            case 4: return 4 * x[-1] - 6 * x[-2] + 4 * x[-3] - x[-4];
+            default: return 0;
+        }
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<char>& outToUse) : out(outToUse) {}
+
+        void write(uint32_t value, int count)
+        {
+            if (count == 0)
+            {
+                return;
+            }
+
+            accumulator = (accumulator << count) | (count == 32 ? value : value & ((1u << count) - 1));
+            bits += count;
+
+            while (bits >= 8)
+            {
+                bits -= 8;
+                out.push_back(static_cast<char>(accumulator >> bits));
+            }
+        }
+
+        void writeRice(uint32_t value, int k)
+        {
+            const auto quotient = value >> k;
+
+            if (quotient < escapeQuotient)
+            {
+                write(1, static_cast<int>(quotient) + 1);
+                write(value, k);
+            }
+            else
+            {
+                write(1, escapeQuotient + 1);
+                write(value, 32);
+            }
+        }
+
+        void flush()
+        {
+            if (bits > 0)
+            {
+                out.push_back(static_cast<char>(accumulator << (8 - bits)));
+            }
+
+            accumulator = 0;
+            bits = 0;
+        }
+
+    private:
+        std::vector<char>& out;
+        uint64_t accumulator = 0;
+        int bits = 0;
+    };
+
+    // Keeps up to 64 bits left-aligned in an accumulator and refills it a byte
+    // at a time. Reading past the end yields zeroes, which isOverrun() detects.
+    class BitReader
+    {
+    public:
+        BitReader(const unsigned char* dataToUse, size_t size) : data(dataToUse), end(dataToUse + size) {}
+
+        uint32_t read(int count)
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+
+            refill();
+            const auto value = static_cast<uint32_t>(accumulator >> (64 - count));
+            accumulator <<= count;
+            bits -= count;
+            return value;
+        }
+
+        bool readRice(int k, uint32_t& value)
+        {
+            refill();
+            const auto zeros = countLeadingZeros(accumulator);
+
+            if (zeros > escapeQuotient)
+            {
+                return false;
+            }
+
+            accumulator <<= zeros + 1;
+            bits -= zeros + 1;
+
+            value = zeros < escapeQuotient ? (static_cast<uint32_t>(zeros) << k) | read(k) : read(32);
+            return true;
+        }
+
+        bool isOverrun() const
+        {
+            return paddedBytes * 8 > bits;
+        }
+
+    private:
+        void refill()
+        {
+            while (bits <= 56)
+            {
+                uint64_t byte = 0;
+
+                if (data < end)
+                {
+                    byte = *data++;
+                }
+                else
+                {
+                    paddedBytes++;
+                }
+
+                accumulator |= byte << (56 - bits);
+                bits += 8;
+            }
+        }
+
+        const unsigned char* data;
+        const unsigned char* end;
+        uint64_t accumulator = 0;
+        int bits = 0;
+        int paddedBytes = 0;
+    };
+
+    size_t riceBits(const uint32_t* u, size_t count, int k)
+    {
+        size_t total = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto quotient = u[i] >> k;
+            total += quotient < escapeQuotient ? quotient + 1 + static_cast<size_t>(k) : escapeQuotient + 1 + 32;
+        }
+
+        return total;
+    }
+
+    int estimateRiceParameter(const uint32_t* u, size_t count)
+    {
+        uint64_t sum = 0;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            sum += u[i];
+        }
+
+        int k = 0;
+
+        while (k < maxRiceParameter && (static_cast<uint64_t>(count) << (k + 1)) <= sum)
+        {
+            k++;
+        }
+
+        return k;
+    }
+
+    int chooseRiceParameter(const uint32_t* u, size_t count, SampleCodec::Level level)
+    {
+        const auto estimate = estimateRiceParameter(u, count);
+
+        if (level != SampleCodec::Level::Small)
+        {
+            return estimate;
+        }
+
+        auto best = estimate;
+        auto bestBits = riceBits(u, count, estimate);
+
+        for (auto k : { estimate - 1, estimate + 1 })
+        {
+            if (k < 0 || k > maxRiceParameter)
+            {
+                continue;
+            }
+
+            const auto candidateBits = riceBits(u, count, k);
+
+            if (candidateBits < bestBits)
+            {
+                best = k;
+                bestBits = candidateBits;
+            }
+        }
+
+        return best;
+    }
+
+    int chooseOrder(const int32_t* x, size_t count, SampleCodec::Level level)
+    {
+        if (level != SampleCodec::Level::Small)
+        {
+            return std::min(2, static_cast<int>(count));
+        }
+
+        uint64_t errors[maxOrder + 1] {};
+
+        for (size_t i = maxOrder; i < count; i++)
+        {
+            for (int order = 0; order <= maxOrder; order++)
+            {
+                const auto residual = x[i] - predict(x + i, order);
+                errors[order] += static_cast<uint64_t>(residual < 0 ? -residual : residual);
+            }
+        }
+
+        int best = 0;
+
+        for (int order = 1; order <= maxOrder; order++)
+        {
+            if (errors[order] < errors[best])
+            {
+                best = order;
+            }
+        }
+
+        return std::min(best, static_cast<int>(count));
+    }
+
+    void encodeBlock(const int32_t* x, size_t count, SampleCodec::Level level, std::vector<char>& out)
+    {
+        const auto order = chooseOrder(x, count, level);
+
+        std::vector<uint32_t> u(count, 0);
+
+        for (size_t i = static_cast<size_t>(order); i < count; i++)
+        {
+            u[i] = zigzag(x[i] - predict(x + i, order));
+        }
+
+        BitWriter writer(out);
+        writer.write(static_cast<uint32_t>(order), 3);
+
+        for (int i = 0; i < order; i++)
+        {
+            writer.write(static_cast<uint16_t>(x[i]), 16);
+        }
+
+        for (size_t start = 0; start < count; start += partitionSize)
+        {
+            const auto first = std::max(start, static_cast<size_t>(order));
+            const auto last = std::min(start + partitionSize, count);
+            const auto residualCount = last > first ? last - first : 0;
+
+            const auto k = residualCount > 0 ? chooseRiceParameter(&u[first], residualCount, level) : 0;
+            writer.write(static_cast<uint32_t>(k), 5);
+
+            for (size_t i = first; i < last; i++)
+            {
+                writer.writeRice(u[i], k);
+            }
+        }
+
+        writer.flush();
+    }
+
+    bool decodeBlock(const unsigned char* data, size_t size, size_t count, int32_t* x)
+    {
+        BitReader reader(data, size);
+
+        const auto order = static_cast<int>(reader.read(3));
+
+        if (order > maxOrder || static_cast<size_t>(order) > count)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < order; i++)
+        {
+            x[i] = static_cast<int16_t>(reader.read(16));
+        }
+
+        for (size_t start = 0; start < count; start += partitionSize)
+        {
+            const auto first = std::max(start, static_cast<size_t>(order));
+            const auto last = std::min(start + partitionSize, count);
+            const auto k = static_cast<int>(reader.read(5));
+
+            if (k > maxRiceParameter)
+            {
+                return false;
+            }
+
+            for (size_t i = first; i < last; i++)
+            {
+                uint32_t u;
+
+                if (!reader.readRice(k, u))
+                {
+                    return false;
+                }
+
+                // A corrupt residual can be anything, so this mustn't overflow
+                const auto sample = static_cast<int64_t>(predict(x + i, order)) + unzigzag(u);
+
+                if (sample < -32768 || sample > 32767)
+                {
+                    return false;
+                }
+
+                x[i] = static_cast<int32_t>(sample);
+            }
+        }
+
+        return !reader.isOverrun();
+    }
+
+    void appendUInt32(std::vector<char>& out, uint32_t value)
+    {
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        const auto bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    void appendUInt64(std::vector<char>& out, uint64_t value)
+    {
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        const auto bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(value));
+    }
+
+    bool readUInt32(const char*& p, const char* end, uint32_t& value)
+    {
+        if (end - p < 4)
+        {
+            return false;
+        }
+
+        std::memcpy(&value, p, sizeof(value));
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        p += sizeof(value);
+        return true;
+    }
+
+    bool readUInt64(const char*& p, const char* end, uint64_t& value)
+    {
+        if (end - p < 8)
+        {
+            return false;
+        }
+
+        std::memcpy(&value, p, sizeof(value));
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        p += sizeof(value);
+        return true;
+    }
+}
+
+std::vector<char> SampleCodec::encode(const char* snd, size_t size, Level level)
+{
+    const auto headerSize = std::min(size, sndHeaderSize);
+    const auto sampleCount = (size - headerSize) / 2;
+    const auto blockCount = (sampleCount + blockSize - 1) / blockSize;
+    const auto pcm = reinterpret_cast<const unsigned char*>(snd + headerSize);
+
+    std::vector<char> out;
+    out.reserve(size / 2);
+
+    appendUInt32(out, formatVersion);
+    appendUInt32(out, static_cast<uint32_t>(headerSize));
+    appendUInt64(out, static_cast<uint64_t>(size));
+    out.insert(out.end(), snd, snd + headerSize);
+    appendUInt32(out, static_cast<uint32_t>(blockCount));
+
+    std::vector<int32_t> x(blockSize);
+
+    for (size_t block = 0; block < blockCount; block++)
+    {
+        const auto first = block * blockSize;
+        const auto count = std::min(blockSize, sampleCount - first);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto p = pcm + (first + i) * 2;
+            x[i] = static_cast<int16_t>(static_cast<uint16_t>(p[0] | (p[1] << 8)));
+        }
+
+        const auto lengthOffset = out.size();
+        appendUInt32(out, 0);
+        encodeBlock(x.data(), count, level, out);
+
+        auto blockLength = juce::ByteOrder::swapIfBigEndian(static_cast<uint32_t>(out.size() - lengthOffset - 4));
+        std::memcpy(&out[lengthOffset], &blockLength, sizeof(blockLength));
+    }
+
+    if ((size - headerSize) % 2 != 0)
+    {
+        out.push_back(snd[size - 1]);
+    }
+
+    return out;
+}
+
+bool SampleCodec::decode(const char* data, size_t size, std::vector<char>& snd)
+{
+    const auto end = data + size;
+    auto p = data;
+
+    uint32_t version, headerSize, blockCount;
+    uint64_t originalSize;
+
+    if (!readUInt32(p, end, version) || version != formatVersion ||
+        !readUInt32(p, end, headerSize) ||
+        !readUInt64(p, end, originalSize) || originalSize < headerSize ||
+        static_cast<uint64_t>(end - p) < headerSize)
+    {
+        return false;
+    }
+
+    const auto sampleCount = static_cast<size_t>((originalSize - headerSize) / 2);
+
+    const auto header = p;
+    p += headerSize;
+
+    // Every sample takes at least one bit, which bounds the size to allocate
+    // before anything is decoded.
+    if (!readUInt32(p, end, blockCount) || blockCount != (sampleCount + blockSize - 1) / blockSize ||
+        sampleCount / 8 > static_cast<size_t>(end - p))
+    {
+        return false;
+    }
+
+    snd.resize(static_cast<size_t>(originalSize));
+    std::copy(header, header + headerSize, snd.begin());
+
+    auto pcm = reinterpret_cast<unsigned char*>(snd.data() + headerSize);
+    std::vector<int32_t> x(blockSize);
+
+    for (size_t block = 0; block < blockCount; block++)
+    {
+        uint32_t blockLength;
+
+        if (!readUInt32(p, end, blockLength) || static_cast<size_t>(end - p) < blockLength)
+        {
+            return false;
+        }
+
+        const auto first = block * blockSize;
+        const auto count = std::min(blockSize, sampleCount - first);
+
+        if (!decodeBlock(reinterpret_cast<const unsigned char*>(p), blockLength, count, x.data()))
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto sample = static_cast<uint16_t>(x[i]);
+            pcm[(first + i) * 2] = static_cast<unsigned char>(sample & 0xff);
+            pcm[(first + i) * 2 + 1] = static_cast<unsigned char>(sample >> 8);
+        }
+
+        p += blockLength;
+    }
+
+    if ((originalSize - headerSize) % 2 != 0)
+    {
+        if (p == end)
+        {
+            return false;
+        }
+
+        snd.back() = *p++;
+    }
+
+    return p == end;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Lossless codec for the 16-bit PCM in SND files, used to shrink the sample
+// payloads in the plugin state.
+//
+// The PCM after the SND header is split into blocks of 4096 samples. Each
+// block is predicted with one of the fixed polynomial predictors of order
+// 0 to 4 and the residuals are Rice coded, with a separate Rice parameter
+// per partition of 256 samples. Blocks are byte-aligned and self-contained.
+// The SND header and a trailing odd byte, if any, are stored as-is, so
+// decoding yields the exact input bytes.
+class SampleCodec
+{
+public:
+    enum class Level
+    {
+        // Store payloads uncompressed
+        None,
+        // Second order prediction only, Rice parameters estimated from the mean
+        Fast,
+        // Best predictor order and exact Rice parameters per partition
+        Small
+    };
+
+    static constexpr size_t sndHeaderSize = 42;
+
+    static std::vector<char> encode(const char* snd, size_t size, Level);
+
+    // Returns false if the data is truncated or corrupt.
+    static bool decode(const char* data, size_t size, std::vector<char>& snd);
+};
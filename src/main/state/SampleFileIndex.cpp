@@ -0,0 +1,245 @@
+#include "SampleFileIndex.h"
+#include "ContentHash.h"
+#include "SampleCodec.h"
+#include "WorkerPool.h"
+
+#include <sampler/Sound.hpp>
+#include <file/sndreader/SndReader.hpp>
+
+using namespace mpc::sampler;
+using namespace mpc::file::sndreader;
+
+namespace
+{
+    uint64_t hashSampleData(std::vector<char>& sndData)
+    {
+        std::vector<float> sampleData;
+        SndReader sndReader(sndData);
+        sndReader.readData(sampleData);
+        return ContentHash::hash(sampleData.data(), sampleData.size() * sizeof(float));
+    }
+}
+
+std::vector<char> SampleFileReference::toChunk() const
+{
+    juce::MemoryOutputStream stream;
+    stream.writeInt64(static_cast<juce::int64>(sampleHash));
+    stream.writeString(juce::String(relativePath));
+    stream.writeInt64(fileSize);
+    stream.writeInt64(static_cast<juce::int64>(fileHash));
+
+    auto begin = static_cast<const char*>(stream.getData());
+    return std::vector<char>(begin, begin + stream.getDataSize());
+}
+
+bool SampleFileReference::fromChunk(const StateChunks::Chunk& chunk)
+{
+    if (chunk.size < sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    juce::MemoryInputStream stream(chunk.data, chunk.size, false);
+
+    sampleHash = static_cast<uint64_t>(stream.readInt64());
+    relativePath = stream.readString().toStdString();
+
+    if (stream.getNumBytesRemaining() < 16)
+    {
+        return false;
+    }
+
+    fileSize = stream.readInt64();
+    fileHash = static_cast<uint64_t>(stream.readInt64());
+    return true;
+}
+
+std::vector<char> SampleFileReference::load(const juce::File& root) const
+{
+    const auto file = root.getChildFile(juce::String(relativePath).replaceCharacter('/', juce::File::getSeparatorChar()));
+
+    // Don't follow references out of the stores directory
+    if (!file.isAChildOf(root) || !file.existsAsFile() || file.getSize() != fileSize)
+    {
+        return {};
+    }
+
+    juce::MemoryBlock data;
+
+    if (!file.loadFileAsData(data) || ContentHash::hash(data.getData(), data.getSize()) != fileHash)
+    {
+        return {};
+    }
+
+    auto begin = static_cast<const char*>(data.getData());
+    return std::vector<char>(begin, begin + data.getSize());
+}
+
+SampleFileIndex::SampleFileIndex(const juce::File& rootToUse)
+    : juce::Thread("VMPC2000XL sample file index"), root(rootToUse)
+{
+}
+
+SampleFileIndex::~SampleFileIndex()
+{
+    stopThread(-1);
+}
+
+std::string SampleFileIndex::getFileKey(const juce::String& name, juce::int64 size)
+{
+    return name.toUpperCase().toStdString() + ":" + std::to_string(size);
+}
+
+void SampleFileIndex::lookUp(const std::vector<std::shared_ptr<Sound>>& sounds)
+{
+    std::unordered_set<std::string> wantedFiles;
+
+    for (auto& sound : sounds)
+    {
+        const auto sndSize = SampleCodec::sndHeaderSize + sound->getSampleData()->size() * sizeof(int16_t);
+        wantedFiles.insert(getFileKey(juce::String(sound->getName()), static_cast<juce::int64>(sndSize)));
+    }
+
+    {
+        const juce::ScopedLock sl(lock);
+        wanted.swap(wantedFiles);
+        hasRequest = true;
+    }
+
+    startThread();
+    notify();
+}
+
+void SampleFileIndex::run()
+{
+    while (!threadShouldExit())
+    {
+        std::unordered_set<std::string> wantedFiles;
+
+        {
+            const juce::ScopedLock sl(lock);
+
+            if (hasRequest)
+            {
+                wantedFiles.swap(wanted);
+                hasRequest = false;
+            }
+        }
+
+        if (wantedFiles.empty())
+        {
+            wait(-1);
+            continue;
+        }
+
+        if (update(wantedFiles) && onFilesFound)
+        {
+            onFilesFound();
+        }
+    }
+}
+
+bool SampleFileIndex::update(const std::unordered_set<std::string>& wantedFiles)
+{
+    struct Candidate
+    {
+        juce::File file;
+        Entry entry;
+        bool valid = false;
+    };
+
+    std::vector<Candidate> changed;
+    std::unordered_map<std::string, Entry> current;
+
+    for (auto& file : root.findChildFiles(juce::File::findFiles, true, "*.SND;*.snd"))
+    {
+        if (threadShouldExit())
+        {
+            return false;
+        }
+
+        const auto size = file.getSize();
+
+        if (wantedFiles.count(getFileKey(file.getFileNameWithoutExtension(), size)) == 0)
+        {
+            continue;
+        }
+
+        // Stored with '/', so states move between platforms
+        const auto relativePath = file.getRelativePathFrom(root).replaceCharacter('\\', '/').toStdString();
+        const auto modified = file.getLastModificationTime();
+
+        {
+            const juce::ScopedLock sl(lock);
+            auto it = files.find(relativePath);
+
+            if (it != files.end() && it->second.modified == modified && it->second.reference.fileSize == size)
+            {
+                current.emplace(relativePath, it->second);
+                continue;
+            }
+        }
+
+        Candidate candidate;
+        candidate.file = file;
+        candidate.entry.modified = modified;
+        candidate.entry.reference.relativePath = relativePath;
+        candidate.entry.reference.fileSize = size;
+        changed.push_back(std::move(candidate));
+    }
+
+    WorkerPool::parallelFor(changed.size(), [&](size_t i) {
+        auto& candidate = changed[i];
+        juce::MemoryBlock data;
+
+        if (!candidate.file.loadFileAsData(data))
+        {
+            return;
+        }
+
+        auto begin = static_cast<const char*>(data.getData());
+        std::vector<char> sndData(begin, begin + data.getSize());
+
+        auto& reference = candidate.entry.reference;
+        reference.fileHash = ContentHash::hash(sndData.data(), sndData.size());
+        reference.sampleHash = hashSampleData(sndData);
+        candidate.valid = true;
+    });
+
+    auto foundFiles = false;
+
+    for (auto& candidate : changed)
+    {
+        if (candidate.valid)
+        {
+            current.emplace(candidate.entry.reference.relativePath, std::move(candidate.entry));
+            foundFiles = true;
+        }
+    }
+
+    // Only the files of the latest project are kept
+    const juce::ScopedLock sl(lock);
+    files.swap(current);
+    pathsBySampleHash.clear();
+
+    for (auto& file : files)
+    {
+        pathsBySampleHash.emplace(file.second.reference.sampleHash, file.first);
+    }
+
+    return foundFiles;
+}
+
+bool SampleFileIndex::find(uint64_t sampleHash, SampleFileReference& reference) const
+{
+    const juce::ScopedLock sl(lock);
+    auto it = pathsBySampleHash.find(sampleHash);
+
+    if (it == pathsBySampleHash.end())
+    {
+        return false;
+    }
+
+    reference = files.at(it->second).reference;
+    return true;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "StateChunks.h"
+
+#include <juce_core/juce_core.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mpc::sampler { class Sound; }
+
+// Sample data that the plugin state refers to by file instead of embedding it.
+//
+// An SFIL chunk holds the hash of the sample data, the path of an SND file
+// relative to the stores directory with '/' as separator, and the size and XXH64 hash of that
+// file. It replaces the PCM chunk with the same sample hash. On restore the
+// file is only used if its size and hash still match.
+struct SampleFileReference
+{
+    uint64_t sampleHash = 0;
+    std::string relativePath;
+    juce::int64 fileSize = 0;
+    uint64_t fileHash = 0;
+
+    static constexpr uint32_t chunkType = StateChunks::fourCC("SFIL");
+
+    std::vector<char> toChunk() const;
+    bool fromChunk(const StateChunks::Chunk&);
+
+    // Returns the SND file if it still matches, or nothing.
+    std::vector<char> load(const juce::File& root) const;
+};
+
+// Knows the sample hash of the SND files under a root directory that may
+// hold the sample data of the project's sounds.
+//
+// lookUp() queues the project's sounds and returns right away. A background
+// thread then lists the root, and only reads and hashes SND files that are
+// named after one of those sounds and have the size its sample data has as
+// an SND file. Files that were hashed before are only hashed again if their
+// size or modification time changed. Saving uses whatever was found so far.
+class SampleFileIndex : private juce::Thread
+{
+public:
+    explicit SampleFileIndex(const juce::File& root);
+    ~SampleFileIndex() override;
+
+    const juce::File& getRoot() const { return root; }
+
+    void lookUp(const std::vector<std::shared_ptr<mpc::sampler::Sound>>& sounds);
+
+    // Returns false if no file under the root is known to have this sample data.
+    bool find(uint64_t sampleHash, SampleFileReference& reference) const;
+
+    // Called on the index thread when it found files it didn't know before,
+    // so a state that was saved without referring to them can be saved again.
+    std::function<void()> onFilesFound;
+
+private:
+    struct Entry
+    {
+        juce::Time modified;
+        SampleFileReference reference;
+    };
+
+    void run() override;
+    bool update(const std::unordered_set<std::string>& wantedFiles);
+
+    // Name and size of the SND file a sound would be saved as
+    static std::string getFileKey(const juce::String& name, juce::int64 size);
+
+    const juce::File root;
+    mutable juce::CriticalSection lock;
+    std::unordered_set<std::string> wanted;
+    bool hasRequest = false;
+    std::unordered_map<std::string, Entry> files;
+    std::unordered_map<uint64_t, std::string> pathsBySampleHash;
+};
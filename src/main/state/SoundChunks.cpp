@@ -0,0 +1,480 @@
+#include "SoundChunks.h"
+#include "ContentHash.h"
+#include "StateCache.h"
+#include "WorkerPool.h"
+#include "LazySoundLoader.h"
+#include "SampleFileIndex.h"
+
+#include <Mpc.hpp>
+#include <sampler/Sampler.hpp>
+#include <sampler/Sound.hpp>
+#include <file/sndwriter/SndWriter.hpp>
+#include <file/sndreader/SndReader.hpp>
+
+#include <Logger.hpp>
+
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace mpc::sampler;
+using namespace mpc::file::sndwriter;
+using namespace mpc::file::sndreader;
+
+uint64_t SoundChunks::hashSampleData(Sound& sound)
+{
+    auto sampleData = sound.getSampleData();
+    return ContentHash::hash(sampleData->data(), sampleData->size() * sizeof(float));
+}
+
+std::vector<uint64_t> SoundChunks::hashSampleData(const std::vector<std::shared_ptr<Sound>>& sounds)
+{
+    std::vector<uint64_t> hashes(sounds.size());
+    WorkerPool::parallelFor(sounds.size(), [&](size_t i) { hashes[i] = hashSampleData(*sounds[i]); });
+    return hashes;
+}
+
+void SoundChunks::writePayload(StateChunkWriter& writer, Sound& sound, uint64_t hash, SampleCodec::Level level)
+{
+    SndWriter sndWriter(&sound);
+    auto sndBytes = sndWriter.getSndFileArray();
+    auto encoding = StateChunks::Encoding::Raw;
+
+    if (level != SampleCodec::Level::None)
+    {
+        auto encoded = SampleCodec::encode(sndBytes.data(), sndBytes.size(), level);
+
+        if (encoded.size() < sndBytes.size())
+        {
+            sndBytes.swap(encoded);
+            encoding = StateChunks::Encoding::LpcRice;
+        }
+    }
+
+    const auto hashBytes = juce::ByteOrder::swapIfBigEndian(hash);
+
+    writer.beginChunk(payload, encoding);
+    writer.write(&hashBytes, sizeof(hashBytes));
+    writer.write(sndBytes.data(), sndBytes.size());
+    writer.endChunk();
+}
+
+std::vector<char> SoundChunks::createPayload(Sound& sound, uint64_t hash)
+{
+    SndWriter sndWriter(&sound);
+    auto sndBytes = sndWriter.getSndFileArray();
+
+    std::vector<char> result(sizeof(uint64_t) + sndBytes.size());
+    const auto hashBytes = juce::ByteOrder::swapIfBigEndian(hash);
+    std::memcpy(result.data(), &hashBytes, sizeof(hashBytes));
+    std::copy(sndBytes.begin(), sndBytes.end(), result.begin() + sizeof(uint64_t));
+    return result;
+}
+
+bool SoundChunks::getPayloadHash(const StateChunks::Chunk& chunk, uint64_t& hash)
+{
+    if (chunk.size < sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    juce::MemoryInputStream stream(chunk.data, chunk.size, false);
+    hash = static_cast<uint64_t>(stream.readInt64());
+    return true;
+}
+
+std::vector<char> SoundChunks::getPayloadSnd(const StateChunks::Chunk& chunk)
+{
+    if (chunk.size < sizeof(uint64_t))
+    {
+        return {};
+    }
+
+    return decodeSnd(chunk.encoding, chunk.data + sizeof(uint64_t), chunk.size - sizeof(uint64_t));
+}
+
+std::vector<char> SoundChunks::decodeSnd(StateChunks::Encoding encoding, const char* data, size_t size)
+{
+    switch (encoding)
+    {
+        case StateChunks::Encoding::Raw:
+            return std::vector<char>(data, data + size);
+
+        case StateChunks::Encoding::LpcRice:
+        {
+            std::vector<char> snd;
+
+            if (SampleCodec::decode(data, size, snd))
+            {
+                return snd;
+            }
+
+            moduru::Logger::l.log("Compressed sample data in the plugin state is corrupt\n");
+            return {};
+        }
+    }
+
+    moduru::Logger::l.log("Unknown sample data encoding " + std::to_string(static_cast<uint32_t>(encoding)) + " in the plugin state\n");
+    return {};
+}
+
+std::vector<char> SoundChunks::createReference(Sound& sound, uint64_t hash)
+{
+    juce::MemoryOutputStream stream;
+    stream.writeInt64(static_cast<juce::int64>(hash));
+    stream.writeString(juce::String(sound.getName()));
+    stream.writeInt(sound.getSampleRate());
+    stream.writeBool(sound.isMono());
+    stream.writeInt(sound.getSndLevel());
+    stream.writeInt(sound.getTune());
+    stream.writeInt(sound.getStart());
+    stream.writeInt(sound.getEnd());
+    stream.writeInt(sound.getLoopTo());
+    stream.writeBool(sound.isLoopEnabled());
+    stream.writeInt(sound.getBeatCount());
+
+    auto begin = static_cast<const char*>(stream.getData());
+    return std::vector<char>(begin, begin + stream.getDataSize());
+}
+
+bool SoundChunks::parseReference(const StateChunks::Chunk& chunk, SoundProperties& properties)
+{
+    // Sample rate, mono, level, tune, start, end, loop to, loop enabled and beat count
+    constexpr juce::int64 propertiesSize = 4 + 1 + 4 + 4 + 4 + 4 + 4 + 1 + 4;
+
+    if (chunk.size < sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    juce::MemoryInputStream stream(chunk.data, chunk.size, false);
+
+    properties.hash = static_cast<uint64_t>(stream.readInt64());
+    properties.name = stream.readString().toStdString();
+
+    if (stream.getNumBytesRemaining() < propertiesSize)
+    {
+        return false;
+    }
+
+    properties.sampleRate = stream.readInt();
+    properties.mono = stream.readBool();
+    properties.level = stream.readInt();
+    properties.tune = stream.readInt();
+    properties.start = stream.readInt();
+    properties.end = stream.readInt();
+    properties.loopTo = stream.readInt();
+    properties.loopEnabled = stream.readBool();
+    properties.beatCount = stream.readInt();
+
+    // The end is checked against the sample data once it is decoded
+    return properties.sampleRate > 0 && properties.start >= 0 && properties.end >= properties.start
+        && properties.loopTo >= 0 && properties.loopTo <= properties.end;
+}
+
+std::shared_ptr<Sound> SoundChunks::addSound(mpc::Mpc& mpc, const SoundProperties& properties, std::vector<float>&& sampleData)
+{
+    auto sound = mpc.getSampler()->addSound(properties.sampleRate);
+    sound->setMono(properties.mono);
+    sound->getSampleData()->swap(sampleData);
+    sound->setName(properties.name);
+    sound->setTune(properties.tune);
+    sound->setLevel(properties.level);
+    sound->setEnd(properties.end);
+    sound->setStart(properties.start);
+    sound->setLoopTo(properties.loopTo);
+    sound->setBeatCount(properties.beatCount);
+    sound->setLoopEnabled(properties.loopEnabled);
+    clampToLength(*sound);
+    return sound;
+}
+
+void SoundChunks::clampToLength(Sound& sound)
+{
+    // A sound must never point past its sample data
+    const auto frameCount = sound.getFrameCount();
+
+    if (sound.getEnd() > frameCount)
+    {
+        sound.setEnd(frameCount);
+    }
+
+    if (sound.getStart() > sound.getEnd())
+    {
+        sound.setStart(sound.getEnd());
+    }
+
+    if (sound.getLoopTo() > sound.getEnd())
+    {
+        sound.setLoopTo(sound.getEnd());
+    }
+}
+
+size_t SoundChunks::getMaxChunkCount(const std::vector<std::shared_ptr<Sound>>& sounds)
+{
+    return sounds.size() * 2;
+}
+
+size_t SoundChunks::estimateSize(const std::vector<std::shared_ptr<Sound>>& sounds, const std::vector<uint64_t>& hashes,
+                                 const SampleFileIndex* fileIndex)
+{
+    // Uncompressed 16-bit PCM, the SND header, the hash and the SREF chunk.
+    // Shared payloads are counted once per sound, so this errs on the high side.
+    constexpr size_t overhead = SampleCodec::sndHeaderSize + sizeof(uint64_t) + 64;
+    size_t size = 0;
+
+    for (size_t i = 0; i < sounds.size(); i++)
+    {
+        auto& sound = sounds[i];
+        size += sound->getName().size() + overhead;
+
+        SampleFileReference fileReference;
+
+        if (fileIndex == nullptr || !fileIndex->find(hashes[i], fileReference))
+        {
+            size += sound->getSampleData()->size() * sizeof(int16_t);
+        }
+    }
+
+    return size;
+}
+
+void SoundChunks::writeSounds(StateChunkWriter& writer, const std::vector<std::shared_ptr<Sound>>& sounds, const std::vector<uint64_t>& hashes,
+                              const StateCache& cache, SampleCodec::Level level, const SampleFileIndex* fileIndex)
+{
+    std::unordered_set<uint64_t> writtenPayloads;
+
+    for (size_t i = 0; i < sounds.size(); i++)
+    {
+        auto& sound = sounds[i];
+        const auto hash = hashes[i];
+
+        if (writtenPayloads.insert(hash).second)
+        {
+            SampleFileReference fileReference;
+
+            if (fileIndex != nullptr && fileIndex->find(hash, fileReference))
+            {
+                writer.addChunk(SampleFileReference::chunkType, fileReference.toChunk());
+            }
+            else if (auto cached = cache.findPayload(hash, level))
+            {
+                writer.addChunk(payload, cached->data, cached->size, cached->encoding);
+            }
+            else
+            {
+                writePayload(writer, *sound, hash, level);
+            }
+        }
+
+        writer.addChunk(reference, createReference(*sound, hash));
+    }
+}
+
+std::vector<std::string> SoundChunks::restoreSounds(mpc::Mpc& mpc, const StateChunkReader& reader, LazySoundLoader* lazyLoader,
+                                                    const juce::File& sampleFileRoot)
+{
+    // Where the sample data of a hash comes from: an embedded PCM chunk, or
+    // else an SND file on disk.
+    struct Source
+    {
+        const StateChunks::Chunk* payload = nullptr;
+        SampleFileReference file;
+        bool hasFile = false;
+
+        bool exists() const { return payload != nullptr || hasFile; }
+    };
+
+    std::unordered_map<uint64_t, Source> sources;
+
+    for (auto chunk : reader.getAll(payload))
+    {
+        uint64_t hash;
+
+        if (getPayloadHash(*chunk, hash))
+        {
+            sources[hash].payload = chunk;
+        }
+    }
+
+    for (auto chunk : reader.getAll(SampleFileReference::chunkType))
+    {
+        SampleFileReference fileReference;
+
+        if (fileReference.fromChunk(*chunk))
+        {
+            auto& source = sources[fileReference.sampleHash];
+            source.file = std::move(fileReference);
+            source.hasFile = true;
+        }
+    }
+
+    auto loadSnd = [sampleFileRoot](const Source& source) -> std::vector<char> {
+        if (source.hasFile)
+        {
+            auto sndData = source.file.load(sampleFileRoot);
+
+            if (!sndData.empty() || source.payload == nullptr)
+            {
+                return sndData;
+            }
+
+            moduru::Logger::l.log("Sample file " + source.file.relativePath + " changed, using the copy in the plugin state\n");
+        }
+
+        return getPayloadSnd(*source.payload);
+    };
+
+    std::vector<SoundProperties> references;
+    std::unordered_map<uint64_t, size_t> decodedIndices;
+    std::vector<Source> toDecode;
+    std::vector<int> remainingUses;
+
+    for (auto chunk : reader.getAll(reference))
+    {
+        SoundProperties properties;
+
+        if (!parseReference(*chunk, properties))
+        {
+            continue;
+        }
+
+        auto inserted = decodedIndices.emplace(properties.hash, toDecode.size());
+
+        if (inserted.second)
+        {
+            auto sourceIt = sources.find(properties.hash);
+            toDecode.push_back(sourceIt == sources.end() ? Source() : sourceIt->second);
+            remainingUses.push_back(0);
+        }
+
+        remainingUses[inserted.first->second]++;
+        references.push_back(std::move(properties));
+    }
+
+    std::vector<std::string> missingSounds;
+
+    if (lazyLoader != nullptr)
+    {
+        std::vector<std::vector<LazySoundLoader::Target>> targets(toDecode.size());
+
+        for (auto& properties : references)
+        {
+            // Silent until the loader commits the real data, see LazySoundLoader.h
+            const auto channels = properties.mono ? 1 : 2;
+            auto sound = addSound(mpc, properties, std::vector<float>(static_cast<size_t>(properties.end) * channels));
+            targets[decodedIndices[properties.hash]].push_back({ sound, properties });
+        }
+
+        for (size_t i = 0; i < toDecode.size(); i++)
+        {
+            if (!toDecode[i].exists())
+            {
+                moduru::Logger::l.log("Sample data of " + std::to_string(targets[i].size()) + " sound(s) is missing from the plugin state\n");
+
+                for (auto& target : targets[i])
+                {
+                    missingSounds.push_back(target.properties.name);
+                }
+
+                continue;
+            }
+
+            // Copy the still encoded payload, so the loader doesn't depend on
+            // the state blob, and leave reading sample files to the loader.
+            Source source = toDecode[i];
+            std::vector<char> payloadCopy;
+
+            if (source.payload != nullptr)
+            {
+                payloadCopy.assign(source.payload->data, source.payload->data + source.payload->size);
+            }
+
+            lazyLoader->add([source, payloadCopy, loadSnd]() mutable {
+                StateChunks::Chunk chunk;
+
+                if (source.payload != nullptr)
+                {
+                    chunk = *source.payload;
+                    chunk.data = payloadCopy.data();
+                    source.payload = &chunk;
+                }
+
+                return loadSnd(source);
+            }, std::move(targets[i]));
+        }
+
+        lazyLoader->start();
+        return missingSounds;
+    }
+
+    std::vector<std::vector<float>> decoded(toDecode.size());
+
+    WorkerPool::parallelFor(toDecode.size(), [&](size_t i) {
+        if (toDecode[i].exists())
+        {
+            auto sndData = loadSnd(toDecode[i]);
+
+            if (!sndData.empty())
+            {
+                SndReader sndReader(sndData);
+                sndReader.readData(decoded[i]);
+            }
+        }
+    });
+
+    for (auto& properties : references)
+    {
+        const auto i = decodedIndices[properties.hash];
+
+        if (decoded[i].empty())
+        {
+            moduru::Logger::l.log("Sample data of sound " + properties.name + " is missing from the plugin state\n");
+            missingSounds.push_back(properties.name);
+        }
+
+        // Each sound gets its own buffer, since sample edits happen in place.
+        // Only the last sound that refers to a payload can take it over.
+        if (--remainingUses[i] == 0)
+        {
+            addSound(mpc, properties, std::move(decoded[i]));
+        }
+        else
+        {
+            auto sampleData = decoded[i];
+            addSound(mpc, properties, std::move(sampleData));
+        }
+    }
+
+    return missingSounds;
+}
+
+void SoundChunks::restoreSndFiles(mpc::Mpc& mpc, size_t count, const std::function<std::vector<char>(size_t)>& getSndData)
+{
+    std::vector<SoundProperties> properties(count);
+    std::vector<std::vector<float>> decoded(count);
+
+    WorkerPool::parallelFor(count, [&](size_t i) {
+        auto sndData = getSndData(i);
+        SndReader sndReader(sndData);
+
+        auto& p = properties[i];
+        p.name = sndReader.getName();
+        p.sampleRate = sndReader.getSampleRate();
+        p.mono = sndReader.isMono();
+        p.level = sndReader.getLevel();
+        p.tune = sndReader.getTune();
+        p.start = sndReader.getStart();
+        p.end = sndReader.getEnd();
+        p.loopTo = p.end - sndReader.getLoopLength();
+        p.loopEnabled = sndReader.isLoopEnabled();
+        p.beatCount = sndReader.getNumberOfBeats();
+
+        sndReader.readData(decoded[i]);
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+        addSound(mpc, properties[i], std::move(decoded[i]));
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "StateChunks.h"
+#include "SampleCodec.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class StateCache;
+class LazySoundLoader;
+class SampleFileIndex;
+
+namespace mpc { class Mpc; }
+namespace mpc::sampler { class Sound; }
+
+// Content-addressed sound storage inside the chunked plugin state.
+//
+// Every distinct sample buffer is stored once as a PCM chunk: the XXH64 hash
+// of the sample data followed by an SND file. Every sound of the sampler gets
+// a small SREF chunk with its properties and the hash of its sample data, so
+// copies and resamples that share the same data share one PCM chunk.
+//
+// With an encoding other than Raw, only the SND file is compressed. The hash
+// always stays in front, so payloads can be looked up without decoding them.
+namespace SoundChunks
+{
+    constexpr uint32_t payload = StateChunks::fourCC("PCM ");
+    constexpr uint32_t reference = StateChunks::fourCC("SREF");
+
+    struct SoundProperties
+    {
+        uint64_t hash = 0;
+        std::string name;
+        int sampleRate = 44100;
+        bool mono = false;
+        int level = 100;
+        int tune = 0;
+        int start = 0;
+        int end = 0;
+        int loopTo = 0;
+        bool loopEnabled = false;
+        int beatCount = 4;
+    };
+
+    uint64_t hashSampleData(mpc::sampler::Sound&);
+    // The hash of every sound's sample data, spread over all cores
+    std::vector<uint64_t> hashSampleData(const std::vector<std::shared_ptr<mpc::sampler::Sound>>&);
+
+    void writePayload(StateChunkWriter&, mpc::sampler::Sound&, uint64_t hash, SampleCodec::Level);
+    // An uncompressed payload
+    std::vector<char> createPayload(mpc::sampler::Sound&, uint64_t hash);
+    bool getPayloadHash(const StateChunks::Chunk&, uint64_t& hash);
+    // The SND file that follows the hash, decoded. Empty if it can't be decoded.
+    std::vector<char> getPayloadSnd(const StateChunks::Chunk&);
+    std::vector<char> decodeSnd(StateChunks::Encoding, const char* data, size_t size);
+
+    std::vector<char> createReference(mpc::sampler::Sound&, uint64_t hash);
+    bool parseReference(const StateChunks::Chunk&, SoundProperties&);
+
+    // Adds a sound to the sampler, sets its properties and takes over the
+    // decoded sample data. Start, end and loop point are kept within it.
+    std::shared_ptr<mpc::sampler::Sound> addSound(mpc::Mpc&, const SoundProperties&, std::vector<float>&& sampleData);
+
+    // Pulls start, end and loop point back to the sound's frame count
+    void clampToLength(mpc::sampler::Sound&);
+
+    // Upper bounds for the number of chunks and the number of bytes that
+    // writeSounds adds, used to reserve the destination up front. hashes are
+    // those of hashSampleData, sample data in the fileIndex isn't counted.
+    size_t getMaxChunkCount(const std::vector<std::shared_ptr<mpc::sampler::Sound>>&);
+    size_t estimateSize(const std::vector<std::shared_ptr<mpc::sampler::Sound>>&, const std::vector<uint64_t>& hashes,
+                        const SampleFileIndex* fileIndex = nullptr);
+
+    // Writes one PCM chunk per distinct sample buffer and one SREF chunk per
+    // sound. Payloads that are already in the cached blob are not re-encoded.
+    // With a fileIndex, sample data that is in an SND file under its root is
+    // stored as an SFIL reference to that file instead, see SampleFileIndex.h.
+    void writeSounds(StateChunkWriter&, const std::vector<std::shared_ptr<mpc::sampler::Sound>>&, const std::vector<uint64_t>& hashes,
+                     const StateCache&, SampleCodec::Level, const SampleFileIndex* fileIndex = nullptr);
+
+    // Decodes every PCM chunk once, spread over all cores, and adds the
+    // sounds in SREF order on the calling thread. With a lazyLoader, the
+    // sounds are added right away and their sample data is left to the loader.
+    // SFIL references are resolved against sampleFileRoot, falling back to
+    // a PCM chunk with the same hash if the file no longer matches.
+    //
+    // Returns the names of the sounds that were added without sample data,
+    // e.g. because the SND file they refer to changed or was removed. With a
+    // lazyLoader, the loader reports the ones it can't load itself.
+    std::vector<std::string> restoreSounds(mpc::Mpc&, const StateChunkReader&, LazySoundLoader* lazyLoader = nullptr,
+                                           const juce::File& sampleFileRoot = {});
+
+    // Decodes complete SND files, like the ones in version 1 states, in
+    // parallel and adds them to the sampler in order on the calling thread.
+    // getSndData(i) is called on a worker thread.
+    void restoreSndFiles(mpc::Mpc&, size_t count, const std::function<std::vector<char>(size_t)>& getSndData);
+}
@@ -0,0 +1,113 @@
+#include "StateAutosaver.h"
+#include "ContentHash.h"
+#include "SoundChunks.h"
+
+StateAutosaver::StateAutosaver(const juce::File& journalFile, juce::int64 validJournalSize,
+                               std::function<uint64_t()> getGenerationToUse,
+                               std::function<StateSnapshot()> createSnapshotToUse)
+    : getGeneration(std::move(getGenerationToUse))
+    , createSnapshot(std::move(createSnapshotToUse))
+    , journal(journalFile, validJournalSize)
+{
+}
+
+StateAutosaver::~StateAutosaver()
+{
+    stopTimer();
+    saveIfChanged();
+}
+
+void StateAutosaver::setJournaledState(const StateChunkReader& reader)
+{
+    savedGeneration = getGeneration();
+
+    if (auto aps = reader.getFirst(StateChunks::aps))
+    {
+        apsHash = ContentHash::hash(aps->data, aps->size);
+    }
+
+    if (auto all = reader.getFirst(StateChunks::all))
+    {
+        allHash = ContentHash::hash(all->data, all->size);
+    }
+
+    for (auto chunk : reader.getAll(SoundChunks::payload))
+    {
+        uint64_t hash;
+
+        if (SoundChunks::getPayloadHash(*chunk, hash))
+        {
+            journaledPayloads.insert(hash);
+        }
+    }
+}
+
+void StateAutosaver::saveIfChanged()
+{
+    const auto generation = getGeneration();
+
+    if (generation == savedGeneration)
+    {
+        return;
+    }
+
+    auto snapshot = createSnapshot();
+
+    if (!snapshot.hasProject)
+    {
+        return;
+    }
+
+    // The sample data is edited in place on this thread, so everything that
+    // reads it happens here. Only sounds that aren't in the journal yet get
+    // a payload, which usually means none.
+    auto pending = std::make_shared<PendingBatch>();
+    pending->aps = std::move(snapshot.aps);
+    pending->all = std::move(snapshot.all);
+
+    const auto hashes = SoundChunks::hashSampleData(snapshot.sounds);
+    std::unordered_set<uint64_t> batchPayloads;
+
+    for (size_t i = 0; i < snapshot.sounds.size(); i++)
+    {
+        auto& sound = *snapshot.sounds[i];
+        const auto hash = hashes[i];
+
+        if (batchPayloads.insert(hash).second && journaledPayloads.count(hash) == 0)
+        {
+            pending->payloads.push_back({ SoundChunks::payload, SoundChunks::createPayload(sound, hash) });
+        }
+
+        pending->references.push_back({ SoundChunks::reference, SoundChunks::createReference(sound, hash) });
+    }
+
+    journaledPayloads.swap(batchPayloads);
+    journal.append([this, pending]() { return createBatch(*pending); });
+    savedGeneration = snapshot.generation;
+}
+
+std::vector<AutosaveJournal::Record> StateAutosaver::createBatch(PendingBatch& pending)
+{
+    std::vector<AutosaveJournal::Record> batch;
+
+    const auto newApsHash = ContentHash::hash(pending.aps.data(), pending.aps.size());
+
+    if (newApsHash != apsHash)
+    {
+        batch.push_back({ StateChunks::aps, std::move(pending.aps) });
+        apsHash = newApsHash;
+    }
+
+    std::move(pending.payloads.begin(), pending.payloads.end(), std::back_inserter(batch));
+    std::move(pending.references.begin(), pending.references.end(), std::back_inserter(batch));
+
+    const auto newAllHash = ContentHash::hash(pending.all.data(), pending.all.size());
+
+    if (newAllHash != allHash)
+    {
+        batch.push_back({ StateChunks::all, std::move(pending.all) });
+        allHash = newAllHash;
+    }
+
+    return batch;
+}
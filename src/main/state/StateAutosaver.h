@@ -0,0 +1,74 @@
+#pragma once
+
+#include "AutosaveJournal.h"
+#include "StateSnapshot.h"
+
+#include <juce_events/juce_events.h>
+
+#include <functional>
+#include <unordered_set>
+
+// Periodically journals the project of the standalone app, see
+// AutosaveJournal.h.
+//
+// On every tick where the state generation moved, a snapshot is taken, see
+// StateSnapshot.h, and turned into a batch that only holds what changed:
+// the APS and ALL bytes if their hash differs from the last batch, and the
+// sample data of sounds that aren't in the journal yet. SREF records for all
+// sounds are small and go into every batch.
+//
+// Sample data is edited in place on the message thread, so it is hashed and
+// copied into payloads there, while the snapshot is taken. The journal
+// thread only gets copies: it compares the APS and ALL hashes and does the
+// file I/O.
+//
+// While sounds are still streaming in after a restore, or while the
+// sequencer records, the tick is skipped.
+class StateAutosaver : private juce::Timer
+{
+public:
+    StateAutosaver(const juce::File& journalFile, juce::int64 validJournalSize,
+                   std::function<uint64_t()> getGeneration,
+                   std::function<StateSnapshot()> createSnapshot);
+
+    // Journals the last changes, then waits for the journal to be written.
+    ~StateAutosaver() override;
+
+    // Call with the state that was just replayed from the journal, so it
+    // isn't journaled again.
+    void setJournaledState(const StateChunkReader&);
+
+    void start(int intervalMs) { startTimer(intervalMs); }
+
+    void saveIfChanged();
+
+private:
+    void timerCallback() override { saveIfChanged(); }
+
+    // What the message thread hands to the journal thread
+    struct PendingBatch
+    {
+        std::vector<char> aps;
+        std::vector<char> all;
+        std::vector<AutosaveJournal::Record> payloads;
+        std::vector<AutosaveJournal::Record> references;
+    };
+
+    // Called on the journal thread, which is the only one that touches
+    // apsHash and allHash once the timer runs.
+    std::vector<AutosaveJournal::Record> createBatch(PendingBatch&);
+
+    std::function<uint64_t()> getGeneration;
+    std::function<StateSnapshot()> createSnapshot;
+
+    uint64_t savedGeneration = 0;
+    uint64_t apsHash = 0;
+    uint64_t allHash = 0;
+    // The payloads of the last batch. Compaction only keeps the payloads of
+    // the last commit, so anything older has to be journaled again.
+    std::unordered_set<uint64_t> journaledPayloads;
+
+    // Last, so the batches it still creates while being destroyed can use
+    // the members above
+    AutosaveJournal journal;
+};
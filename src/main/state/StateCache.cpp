@@ -0,0 +1,42 @@
+#include "StateCache.h"
+#include "SoundChunks.h"
+
+bool StateCache::isClean(uint64_t currentGeneration, const std::string& uiXml) const
+{
+    return blobGeneration == currentGeneration && blob.getSize() > 0 && blobUiXml == uiXml;
+}
+
+const StateChunks::Chunk* StateCache::findPayload(uint64_t hash, SampleCodec::Level level) const
+{
+    if (level != blobPayloadLevel)
+    {
+        return nullptr;
+    }
+
+    auto it = payloads.find(hash);
+    return it == payloads.end() ? nullptr : &it->second;
+}
+
+void StateCache::store(uint64_t builtGeneration, std::string uiXml, const juce::MemoryBlock& newBlob, SampleCodec::Level payloadLevel)
+{
+    // The payloads point into the previous blob
+    payloads.clear();
+    blob.reset();
+
+    blob = newBlob;
+    blobPayloadLevel = payloadLevel;
+    blobGeneration = builtGeneration;
+    blobUiXml = std::move(uiXml);
+
+    StateChunkReader reader(blob.getData(), blob.getSize());
+
+    for (auto chunk : reader.getAll(SoundChunks::payload))
+    {
+        uint64_t hash;
+
+        if (SoundChunks::getPayloadHash(*chunk, hash))
+        {
+            payloads[hash] = *chunk;
+        }
+    }
+}
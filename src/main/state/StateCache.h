@@ -0,0 +1,44 @@
+#pragma once
+
+#include "StateChunks.h"
+#include "SampleCodec.h"
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+// Keeps the last serialized plugin state around, so that repeated host state
+// queries don't re-serialize an unchanged project.
+//
+// Anything that may have modified the sampler, the sequencer or the MPC UI
+// calls markDirty(), which bumps a generation counter. A blob built at the
+// current generation is handed out as-is. Otherwise the blob is rebuilt, but
+// sample payloads whose content hash is already in the previous blob are
+// copied over from it instead of going through SndWriter again.
+class StateCache
+{
+public:
+    // Safe to call from any thread, including the audio thread.
+    void markDirty() noexcept { generation.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t getGeneration() const noexcept { return generation.load(std::memory_order_relaxed); }
+
+    bool isClean(uint64_t currentGeneration, const std::string& uiXml) const;
+    const juce::MemoryBlock& getBlob() const { return blob; }
+
+    // Returns the PCM chunk with this content hash from the previous blob,
+    // or nullptr if there is none or it was compressed at another level.
+    const StateChunks::Chunk* findPayload(uint64_t hash, SampleCodec::Level level) const;
+
+    // Keeps a copy of a freshly written blob, whose payloads were compressed
+    // at payloadLevel. The previous blob is released before copying, so
+    // this never holds more than the new blob and its copy.
+    void store(uint64_t builtGeneration, std::string uiXml, const juce::MemoryBlock& newBlob, SampleCodec::Level payloadLevel);
+
+private:
+    std::atomic<uint64_t> generation { 1 };
+    uint64_t blobGeneration = 0;
+    std::string blobUiXml;
+    juce::MemoryBlock blob;
+    SampleCodec::Level blobPayloadLevel = SampleCodec::Level::None;
+    std::unordered_map<uint64_t, StateChunks::Chunk> payloads;
+};
@@ -0,0 +1,225 @@
+#include "StateChunks.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace StateChunks;
+
+namespace
+{
+    size_t align8(size_t value)
+    {
+        return (value + 7) & ~static_cast<size_t>(7);
+    }
+
+    void writeUInt32(char* dest, uint32_t value)
+    {
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        std::memcpy(dest, &value, sizeof(value));
+    }
+
+    void writeUInt64(char* dest, uint64_t value)
+    {
+        value = juce::ByteOrder::swapIfBigEndian(value);
+        std::memcpy(dest, &value, sizeof(value));
+    }
+
+    uint32_t readUInt32(const char* src)
+    {
+        uint32_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return juce::ByteOrder::swapIfBigEndian(value);
+    }
+
+    uint64_t readUInt64(const char* src)
+    {
+        uint64_t value;
+        std::memcpy(&value, src, sizeof(value));
+        return juce::ByteOrder::swapIfBigEndian(value);
+    }
+}
+
+bool StateChunks::isChunkedState(const void* data, size_t size)
+{
+    return data != nullptr && size >= headerSize && readUInt32(static_cast<const char*>(data)) == magic;
+}
+
+StateChunkWriter::StateChunkWriter(juce::MemoryBlock& destData, size_t maxChunksToUse, size_t sizeHint)
+    : dest(destData), maxChunks(maxChunksToUse), position(align8(headerSize + maxChunksToUse * tocEntrySize))
+{
+    dest.setSize(position + sizeHint + maxChunks * 8, false);
+    std::memset(dest.getData(), 0, position);
+}
+
+void StateChunkWriter::addChunk(uint32_t type, const void* data, size_t size, Encoding encoding)
+{
+    beginChunk(type, encoding);
+    write(data, size);
+    endChunk();
+}
+
+void StateChunkWriter::beginChunk(uint32_t type, Encoding encoding)
+{
+    jassert(!inChunk);
+
+    if (chunkCount == maxChunks)
+    {
+        growTableOfContents();
+    }
+
+    auto entry = static_cast<char*>(dest.getData()) + headerSize + chunkCount * tocEntrySize;
+    writeUInt32(entry, type);
+    writeUInt32(entry + 4, static_cast<uint32_t>(encoding));
+    writeUInt64(entry + 8, position);
+
+    chunkStart = position;
+    inChunk = true;
+}
+
+void StateChunkWriter::write(const void* data, size_t size)
+{
+    if (!inChunk || size == 0)
+    {
+        return;
+    }
+
+    ensureSpace(size);
+    std::memcpy(static_cast<char*>(dest.getData()) + position, data, size);
+    position += size;
+}
+
+void StateChunkWriter::endChunk()
+{
+    if (!inChunk)
+    {
+        return;
+    }
+
+    auto entry = static_cast<char*>(dest.getData()) + headerSize + chunkCount * tocEntrySize;
+    writeUInt64(entry + 16, position - chunkStart);
+
+    const auto padding = align8(position) - position;
+    ensureSpace(padding);
+    std::memset(static_cast<char*>(dest.getData()) + position, 0, padding);
+    position += padding;
+
+    chunkCount++;
+    inChunk = false;
+}
+
+void StateChunkWriter::finish()
+{
+    jassert(!inChunk);
+
+    auto header = static_cast<char*>(dest.getData());
+    writeUInt32(header, magic);
+    writeUInt32(header + 4, currentVersion);
+    writeUInt32(header + 8, static_cast<uint32_t>(chunkCount));
+    writeUInt32(header + 12, 0);
+
+    dest.setSize(position, false);
+}
+
+void StateChunkWriter::growTableOfContents()
+{
+    // maxChunks was a low estimate. Moving the chunks written so far is
+    // costly, but still better than a state that lacks data.
+    jassertfalse;
+
+    const auto oldDataStart = align8(headerSize + maxChunks * tocEntrySize);
+    maxChunks = std::max(maxChunks * 2, maxChunks + 16);
+    const auto shift = align8(headerSize + maxChunks * tocEntrySize) - oldDataStart;
+
+    ensureSpace(shift);
+
+    auto data = static_cast<char*>(dest.getData());
+    std::memmove(data + oldDataStart + shift, data + oldDataStart, position - oldDataStart);
+    std::memset(data + oldDataStart, 0, shift);
+
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        auto entry = data + headerSize + i * tocEntrySize;
+        writeUInt64(entry + 8, readUInt64(entry + 8) + shift);
+    }
+
+    position += shift;
+}
+
+void StateChunkWriter::ensureSpace(size_t size)
+{
+    if (position + size > dest.getSize())
+    {
+        dest.setSize(std::max(position + size, dest.getSize() + dest.getSize() / 2), false);
+    }
+}
+
+StateChunkReader::StateChunkReader(const void* data, size_t size)
+{
+    if (!isChunkedState(data, size))
+    {
+        return;
+    }
+
+    auto src = static_cast<const char*>(data);
+
+    version = readUInt32(src + 4);
+    const auto chunkCount = static_cast<size_t>(readUInt32(src + 8));
+
+    if (version == 0 || version > currentVersion || chunkCount > (size - headerSize) / tocEntrySize)
+    {
+        return;
+    }
+
+    chunks.reserve(chunkCount);
+
+    for (size_t i = 0; i < chunkCount; i++)
+    {
+        auto entry = src + headerSize + i * tocEntrySize;
+
+        const auto chunkOffset = readUInt64(entry + 8);
+        const auto chunkSize = readUInt64(entry + 16);
+
+        if (chunkOffset > size || chunkSize > size - chunkOffset)
+        {
+            chunks.clear();
+            return;
+        }
+
+        Chunk chunk;
+        chunk.type = readUInt32(entry);
+        chunk.encoding = static_cast<Encoding>(readUInt32(entry + 4));
+        chunk.data = src + chunkOffset;
+        chunk.size = static_cast<size_t>(chunkSize);
+        chunks.push_back(chunk);
+    }
+
+    valid = true;
+}
+
+const Chunk* StateChunkReader::getFirst(uint32_t type) const
+{
+    for (auto& c : chunks)
+    {
+        if (c.type == type)
+        {
+            return &c;
+        }
+    }
+
+    return nullptr;
+}
+
+std::vector<const Chunk*> StateChunkReader::getAll(uint32_t type) const
+{
+    std::vector<const Chunk*> result;
+
+    for (auto& c : chunks)
+    {
+        if (c.type == type)
+        {
+            result.push_back(&c);
+        }
+    }
+
+    return result;
+}
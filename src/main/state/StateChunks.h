@@ -0,0 +1,120 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+#include <vector>
+
+// Versioned binary container for the plugin state.
+//
+// Layout (all integers little-endian):
+//   header   magic "VMPS", version, chunk count, reserved
+//   toc      one entry per chunk: type, encoding, offset, size, possibly
+//            followed by unused entries
+//   payload  raw chunk data, 8-byte aligned, offsets relative to the header
+//
+// Chunks of the same type keep their relative order, so e.g. the n-th SND
+// chunk is the n-th sound of the sampler.
+//
+// Version 1 stores one SND chunk per sound. Version 2 stores sounds
+// content-addressed, see SoundChunks.h. Readers handle both.
+namespace StateChunks
+{
+    constexpr uint32_t fourCC(const char (&id)[5])
+    {
+        return static_cast<uint32_t>(static_cast<unsigned char>(id[0]))
+             | static_cast<uint32_t>(static_cast<unsigned char>(id[1])) << 8
+             | static_cast<uint32_t>(static_cast<unsigned char>(id[2])) << 16
+             | static_cast<uint32_t>(static_cast<unsigned char>(id[3])) << 24;
+    }
+
+    constexpr uint32_t magic = fourCC("VMPS");
+    constexpr uint32_t currentVersion = 2;
+
+    constexpr uint32_t ui = fourCC("UI  ");
+    constexpr uint32_t aps = fourCC("APS ");
+    constexpr uint32_t all = fourCC("ALL ");
+    constexpr uint32_t snd = fourCC("SND ");
+
+    enum class Encoding : uint32_t
+    {
+        Raw = 0,
+        // See SampleCodec.h
+        LpcRice = 1
+    };
+
+    constexpr size_t headerSize = 16;
+    constexpr size_t tocEntrySize = 24;
+
+    struct Chunk
+    {
+        uint32_t type = 0;
+        Encoding encoding = Encoding::Raw;
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+    bool isChunkedState(const void* data, size_t size);
+}
+
+// Writes a chunked state straight into the destination block, so every
+// chunk is copied exactly once. The table of contents is reserved up front
+// for maxChunks chunks; unused entries are left as padding. Writing more
+// chunks still works, but moves everything written so far.
+class StateChunkWriter
+{
+public:
+    // sizeHint is the expected total payload size. Reserving it up front
+    // avoids reallocating the destination while writing.
+    StateChunkWriter(juce::MemoryBlock& destData, size_t maxChunks, size_t sizeHint = 0);
+
+    void addChunk(uint32_t type, const void* data, size_t size,
+                  StateChunks::Encoding encoding = StateChunks::Encoding::Raw);
+
+    void addChunk(uint32_t type, const std::vector<char>& data,
+                  StateChunks::Encoding encoding = StateChunks::Encoding::Raw)
+    {
+        addChunk(type, data.data(), data.size(), encoding);
+    }
+
+    // Writes a chunk in pieces, for payloads that are assembled from more
+    // than one buffer.
+    void beginChunk(uint32_t type, StateChunks::Encoding encoding = StateChunks::Encoding::Raw);
+    void write(const void* data, size_t size);
+    void endChunk();
+
+    // Writes the header and trims the destination to the bytes written.
+    void finish();
+
+private:
+    void ensureSpace(size_t size);
+    // Makes room for more than maxChunks entries by moving the chunks up
+    void growTableOfContents();
+
+    juce::MemoryBlock& dest;
+    size_t maxChunks;
+    size_t chunkCount = 0;
+    size_t position;
+    size_t chunkStart = 0;
+    bool inChunk = false;
+};
+
+// Parses the table of contents of a chunked state blob. Chunks point straight
+// into the caller's buffer, so that buffer has to outlive the reader.
+class StateChunkReader
+{
+public:
+    StateChunkReader(const void* data, size_t size);
+
+    bool isValid() const { return valid; }
+    uint32_t getVersion() const { return version; }
+
+    const std::vector<StateChunks::Chunk>& getChunks() const { return chunks; }
+    const StateChunks::Chunk* getFirst(uint32_t type) const;
+    std::vector<const StateChunks::Chunk*> getAll(uint32_t type) const;
+
+private:
+    bool valid = false;
+    uint32_t version = 0;
+    std::vector<StateChunks::Chunk> chunks;
+};
@@ -0,0 +1,55 @@
+#include "StateSnapshot.h"
+#include "StateChunks.h"
+#include "SoundChunks.h"
+
+#include <Mpc.hpp>
+#include <sampler/Sampler.hpp>
+#include <file/aps/ApsParser.hpp>
+#include <file/all/AllParser.hpp>
+
+using namespace mpc::file::aps;
+using namespace mpc::file::all;
+
+bool StateSnapshot::captureProject(mpc::Mpc& mpc, const ProjectEditGate& gate)
+{
+    hasProject = gate.read([&] {
+        ApsParser apsParser(mpc, "stateinfo");
+        aps = apsParser.getBytes();
+
+        AllParser allParser(mpc);
+        all = allParser.getBytes();
+
+        sounds = mpc.getSampler()->getSounds();
+    });
+
+    if (!hasProject)
+    {
+        aps.clear();
+        all.clear();
+        sounds.clear();
+    }
+
+    return hasProject;
+}
+
+void StateSnapshot::writeTo(juce::MemoryBlock& destData, const StateCache& cache, SampleCodec::Level level,
+                            const SampleFileIndex* fileIndex) const
+{
+    // Every section is written once, straight into destData, which is
+    // reserved for its expected size up front.
+    const auto hashes = hasProject ? SoundChunks::hashSampleData(sounds) : std::vector<uint64_t>();
+    const auto maxChunks = 3 + (hasProject ? SoundChunks::getMaxChunkCount(sounds) : 0);
+    const auto sizeHint = uiXml.size() + aps.size() + all.size() + (hasProject ? SoundChunks::estimateSize(sounds, hashes, fileIndex) : 0);
+
+    StateChunkWriter writer(destData, maxChunks, sizeHint);
+    writer.addChunk(StateChunks::ui, uiXml.data(), uiXml.size());
+
+    if (hasProject)
+    {
+        writer.addChunk(StateChunks::aps, aps);
+        SoundChunks::writeSounds(writer, sounds, hashes, cache, level, fileIndex);
+        writer.addChunk(StateChunks::all, all);
+    }
+
+    writer.finish();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ProjectEditGate.h"
+#include "SampleCodec.h"
+
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class StateCache;
+class SampleFileIndex;
+
+namespace mpc { class Mpc; }
+namespace mpc::sampler { class Sound; }
+
+// Everything that goes into the plugin state, captured at one point in time.
+//
+// The project (APS and ALL bytes and the list of sounds) is captured on the
+// calling thread while audio keeps running, see ProjectEditGate.h. Once
+// captured, a snapshot no longer touches the sequencer or the sampler, so
+// it can be serialized on any thread.
+//
+// Sample data is shared with the sampler rather than copied, and it is
+// edited in place on the message thread. Serializing the sounds therefore
+// has to happen on the message thread, see StateAutosaver.h for a
+// background save that copies what it needs first.
+struct StateSnapshot
+{
+    uint64_t generation = 0;
+    std::string uiXml;
+
+    bool hasProject = false;
+    std::vector<char> aps;
+    std::vector<char> all;
+    std::vector<std::shared_ptr<mpc::sampler::Sound>> sounds;
+
+    // Parses the APS and ALL and collects the sounds. Returns false, and
+    // leaves the snapshot without a project, if the audio thread may have
+    // edited the project meanwhile.
+    bool captureProject(mpc::Mpc&, const ProjectEditGate&);
+
+    // Writes a chunked state blob. Payloads found in the cache are copied
+    // from it instead of being encoded again, so the cache must not change
+    // while this runs. Likewise for the optional fileIndex, which turns
+    // sample data that is on disk into file references.
+    void writeTo(juce::MemoryBlock& destData, const StateCache&, SampleCodec::Level,
+                 const SampleFileIndex* fileIndex = nullptr) const;
+};
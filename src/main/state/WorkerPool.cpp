@@ -0,0 +1,61 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+WorkerPool::WorkerPool()
+    : pool(std::max(1, juce::SystemStats::getNumCpus() - 1))
+{
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Shared with the jobs, since a helper may still be signalling while
+    // this call has already returned.
+    struct Progress
+    {
+        std::atomic<size_t> next { 0 };
+        std::atomic<int> remainingHelpers { 0 };
+        juce::WaitableEvent helpersDone;
+    };
+
+    auto progress = std::make_shared<Progress>();
+
+    // fn is only touched while there are indices left, which is before
+    // this call can return.
+    auto work = [progress, count, &fn]() {
+        for (auto i = progress->next.fetch_add(1); i < count; i = progress->next.fetch_add(1))
+        {
+            fn(i);
+        }
+    };
+
+    juce::SharedResourcePointer<WorkerPool> workerPool;
+    auto& pool = workerPool->pool;
+    const auto helperCount = static_cast<int>(std::min(count - 1, static_cast<size_t>(pool.getNumThreads())));
+    progress->remainingHelpers = helperCount;
+
+    for (int i = 0; i < helperCount; i++)
+    {
+        pool.addJob([progress, work]() {
+            work();
+
+            if (progress->remainingHelpers.fetch_sub(1) == 1)
+            {
+                progress->helpersDone.signal();
+            }
+        });
+    }
+
+    work();
+
+    if (helperCount > 0)
+    {
+        progress->helpersDone.wait();
+    }
+}
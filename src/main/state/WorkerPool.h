@@ -0,0 +1,29 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <cstddef>
+#include <functional>
+
+// Worker threads for CPU-bound state (de)serialization, shared by all plugin
+// instances so that restoring several of them at once doesn't oversubscribe
+// the machine.
+//
+// The threads live as long as someone holds a
+// juce::SharedResourcePointer<WorkerPool>. Every plugin instance holds one,
+// so they are stopped when the last instance is deleted rather than during
+// static destruction when the plugin is unloaded, which on Windows would
+// join them under the loader lock. Without a holder, parallelFor starts and
+// stops the threads for the duration of the call.
+class WorkerPool
+{
+public:
+    WorkerPool();
+
+    // Calls fn(i) for every i in [0, count), spread over all cores. The calling
+    // thread takes part and returns once every call has finished.
+    static void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+private:
+    juce::ThreadPool pool;
+};
@@ -0,0 +1,388 @@
+// Renders MPC projects to WAV files, without a display or audio device.
+//
+//   vmpc2000xl_Render [--sequence 0 | --song 0] [--stems] [--sample-rate 44100]
+//                     [--tail 2] [--max-seconds 3600] [--jobs 4]
+//                     [--out-dir renders] PROJECT.APS|PROJECT.ALL ...
+//
+// A project is an APS and/or an ALL file. A sibling with the same name and
+// the other extension is loaded along with it, and the sounds of the APS are
+// read from the SND files in the same directory. The sequence or song plays
+// from the start until it ends, followed by --tail seconds for decays.
+//
+// STEREO OUT goes to NAME.wav. With --stems, MIX OUT 1/2 to 7/8 go to
+// NAME-MIX12.wav and so on. Projects render in parallel, --jobs at a time,
+// each with its own mpc::Mpc.
+
+#include "state/SoundChunks.h"
+#include "state/WorkerPool.h"
+
+#include <Mpc.hpp>
+#include <audiomidi/AudioMidiServices.hpp>
+#include <audio/server/NonRealTimeAudioServer.hpp>
+#include <file/aps/ApsParser.hpp>
+#include <file/all/AllParser.hpp>
+#include <disk/ApsLoader.hpp>
+#include <disk/AllLoader.hpp>
+#include <lcdgui/screens/SongScreen.hpp>
+#include <sequencer/Sequencer.hpp>
+#include <sequencer/Sequence.hpp>
+#include <sequencer/Song.hpp>
+
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+using namespace mpc::disk;
+using namespace mpc::file::aps;
+using namespace mpc::file::all;
+using namespace mpc::lcdgui::screens;
+
+namespace
+{
+    // STEREO OUT and MIX OUT 1/2 to 7/8, as in mpc.init(1, 5)
+    constexpr int stereoOutputCount = 5;
+    constexpr int blockSize = 512;
+
+    struct Options
+    {
+        int sequenceIndex = -1;
+        int songIndex = -1;
+        bool stems = false;
+        double sampleRate = 44100.0;
+        double tailSeconds = 2.0;
+        double maxSeconds = 3600.0;
+        juce::File outDir;
+    };
+
+    struct Project
+    {
+        juce::String name;
+        juce::File aps;
+        juce::File all;
+    };
+
+    struct Result
+    {
+        bool rendered = false;
+        juce::String message;
+        double seconds = 0.0;
+    };
+
+    Project findProject(const juce::File& file)
+    {
+        Project project;
+        project.name = file.getFileNameWithoutExtension();
+
+        auto sibling = [&](const juce::String& extension) {
+            for (auto& candidate : file.getParentDirectory().findChildFiles(juce::File::findFiles, false, project.name + ".*"))
+            {
+                if (candidate.getFileExtension().equalsIgnoreCase(extension))
+                {
+                    return candidate;
+                }
+            }
+
+            return juce::File();
+        };
+
+        project.aps = sibling(".APS");
+        project.all = sibling(".ALL");
+        return project;
+    }
+
+    std::vector<char> loadFile(const juce::File& file)
+    {
+        juce::MemoryBlock data;
+
+        if (!file.loadFileAsData(data))
+        {
+            return {};
+        }
+
+        auto bytes = static_cast<const char*>(data.getData());
+        return std::vector<char>(bytes, bytes + data.getSize());
+    }
+
+    // The APS refers to its sounds by name, and the program assignments to
+    // their index, so every name gets a sound even if its file is missing.
+    void loadSounds(mpc::Mpc& mpc, ApsParser& apsParser, const juce::File& directory, juce::String& warnings)
+    {
+        std::map<juce::String, juce::File> sndFiles;
+
+        for (auto& file : directory.findChildFiles(juce::File::findFiles, false))
+        {
+            if (file.getFileExtension().equalsIgnoreCase(".SND"))
+            {
+                sndFiles[file.getFileNameWithoutExtension().trimEnd().toUpperCase()] = file;
+            }
+        }
+
+        auto soundNames = apsParser.getSoundNames();
+        std::vector<std::vector<char>> sndData(soundNames.size());
+
+        for (size_t i = 0; i < soundNames.size(); i++)
+        {
+            auto it = sndFiles.find(juce::String(soundNames[i]).trimEnd().toUpperCase());
+
+            if (it != sndFiles.end())
+            {
+                sndData[i] = loadFile(it->second);
+            }
+
+            if (sndData[i].empty())
+            {
+                warnings += "missing sound " + juce::String(soundNames[i]) + "; ";
+            }
+        }
+
+        for (size_t i = 0; i < soundNames.size(); i++)
+        {
+            if (sndData[i].empty())
+            {
+                SoundChunks::SoundProperties placeholder;
+                placeholder.name = soundNames[i];
+                SoundChunks::addSound(mpc, placeholder, {});
+                continue;
+            }
+
+            SoundChunks::restoreSndFiles(mpc, 1, [&](size_t) { return std::move(sndData[i]); });
+        }
+    }
+
+    bool loadProject(mpc::Mpc& mpc, const Project& project, juce::String& message)
+    {
+        if (project.aps.existsAsFile())
+        {
+            auto apsData = loadFile(project.aps);
+
+            if (apsData.empty())
+            {
+                message = "can't read " + project.aps.getFullPathName();
+                return false;
+            }
+
+            ApsParser apsParser(mpc, apsData);
+            ApsLoader::loadFromParsedAps(apsParser, mpc, true, true);
+            loadSounds(mpc, apsParser, project.aps.getParentDirectory(), message);
+        }
+
+        if (project.all.existsAsFile())
+        {
+            auto allData = loadFile(project.all);
+
+            if (allData.empty())
+            {
+                message = "can't read " + project.all.getFullPathName();
+                return false;
+            }
+
+            AllParser allParser(mpc, allData);
+            AllLoader::loadEverythingFromAllParser(mpc, allParser);
+        }
+
+        return true;
+    }
+
+    void startPlayback(mpc::Mpc& mpc, const Options& options)
+    {
+        auto sequencer = mpc.getSequencer();
+
+        if (options.songIndex >= 0)
+        {
+            sequencer->getSong(options.songIndex)->setLoopEnabled(false);
+            mpc.screens->get<SongScreen>("song")->setActiveSongIndex(options.songIndex);
+            mpc.getLayeredScreen()->openScreen("song");
+        }
+        else
+        {
+            if (options.sequenceIndex >= 0)
+            {
+                sequencer->setActiveSequenceIndex(options.sequenceIndex);
+            }
+
+            sequencer->getActiveSequence()->setLoopEnabled(false);
+        }
+
+        sequencer->playFromStart();
+    }
+
+    Result renderProject(const Project& project, const Options& options)
+    {
+        mpc::Mpc mpc;
+        mpc.init(1, stereoOutputCount);
+
+        Result result;
+
+        if (!loadProject(mpc, project, result.message))
+        {
+            return result;
+        }
+
+        auto audioMidiServices = mpc.getAudioMidiServices();
+        auto server = audioMidiServices->getAudioServer();
+        server->setSampleRate(static_cast<int>(options.sampleRate));
+        server->resizeBuffers(blockSize);
+
+        const int outputCount = options.stems ? stereoOutputCount : 1;
+        std::vector<std::unique_ptr<juce::AudioFormatWriter>> writers;
+        juce::WavAudioFormat wav;
+
+        for (int i = 0; i < outputCount; i++)
+        {
+            const auto suffix = i == 0 ? juce::String() : "-MIX" + juce::String(i * 2 - 1) + juce::String(i * 2);
+            const auto file = options.outDir.getChildFile(project.name + suffix + ".wav");
+            file.deleteFile();
+
+            auto stream = std::make_unique<juce::FileOutputStream>(file);
+
+            if (!stream->failedToOpen())
+            {
+                writers.emplace_back(wav.createWriterFor(stream.get(), options.sampleRate, 2, 24, {}, 0));
+            }
+
+            if (writers.size() != static_cast<size_t>(i + 1) || writers.back() == nullptr)
+            {
+                result.message = "can't write " + file.getFullPathName();
+                return result;
+            }
+
+            stream.release();
+        }
+
+        juce::AudioBuffer<float> input(2, blockSize);
+        juce::AudioBuffer<float> output(stereoOutputCount * 2, blockSize);
+        input.clear();
+
+        startPlayback(mpc, options);
+
+        auto sequencer = mpc.getSequencer();
+        const auto maxBlocks = static_cast<int64_t>(options.maxSeconds * options.sampleRate / blockSize);
+        const auto tailBlocks = static_cast<int64_t>(options.tailSeconds * options.sampleRate / blockSize);
+        int64_t blocksAfterStop = 0;
+
+        for (int64_t block = 0; block < maxBlocks && blocksAfterStop <= tailBlocks; block++)
+        {
+            output.clear();
+            server->work(input.getArrayOfReadPointers(), output.getArrayOfWritePointers(), blockSize, 2, stereoOutputCount * 2);
+
+            for (int i = 0; i < outputCount; i++)
+            {
+                const float* channels[] = { output.getReadPointer(i * 2), output.getReadPointer(i * 2 + 1) };
+                writers[static_cast<size_t>(i)]->writeFromFloatArrays(channels, 2, blockSize);
+            }
+
+            if (!sequencer->isPlaying())
+            {
+                blocksAfterStop++;
+            }
+        }
+
+        if (sequencer->isPlaying())
+        {
+            sequencer->stop();
+            result.message += "stopped after " + juce::String(options.maxSeconds) + " seconds; ";
+        }
+
+        result.rendered = true;
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ArgumentList args(argc, argv);
+
+    Options options;
+    options.sequenceIndex = args.containsOption("--sequence") ? args.getValueForOption("--sequence").getIntValue() : -1;
+    options.songIndex = args.containsOption("--song") ? args.getValueForOption("--song").getIntValue() : -1;
+    options.stems = args.containsOption("--stems");
+    options.sampleRate = args.containsOption("--sample-rate") ? args.getValueForOption("--sample-rate").getDoubleValue() : 44100.0;
+    options.tailSeconds = args.containsOption("--tail") ? args.getValueForOption("--tail").getDoubleValue() : 2.0;
+    options.maxSeconds = args.containsOption("--max-seconds") ? args.getValueForOption("--max-seconds").getDoubleValue() : 3600.0;
+    options.outDir = juce::File::getCurrentWorkingDirectory().getChildFile(args.containsOption("--out-dir") ? args.getValueForOption("--out-dir") : juce::String("."));
+
+    const auto jobs = std::max(1, args.containsOption("--jobs") ? args.getValueForOption("--jobs").getIntValue() : juce::SystemStats::getNumCpus());
+
+    std::vector<Project> projects;
+
+    for (auto& argument : args.arguments)
+    {
+        if (argument.isOption())
+        {
+            continue;
+        }
+
+        const auto file = argument.resolveAsFile();
+
+        if (!file.existsAsFile())
+        {
+            std::cerr << "Skipping " << file.getFullPathName() << ", which doesn't exist" << std::endl;
+        }
+        else if (file.hasFileExtension("aps;all"))
+        {
+            auto project = findProject(file);
+
+            // NAME.APS and NAME.ALL on the same command line are one project
+            auto isSame = [&](const Project& other) { return other.aps == project.aps && other.all == project.all; };
+
+            if (std::none_of(projects.begin(), projects.end(), isSame))
+            {
+                projects.push_back(project);
+            }
+        }
+    }
+
+    if (projects.empty())
+    {
+        std::cerr << "Usage: vmpc2000xl_Render [--sequence N | --song N] [--stems] [--sample-rate 44100] [--tail 2]"
+                  << " [--max-seconds 3600] [--jobs N] [--out-dir DIR] PROJECT.APS|PROJECT.ALL ..." << std::endl;
+        return 1;
+    }
+
+    if (!options.outDir.createDirectory())
+    {
+        std::cerr << "Can't create " << options.outDir.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results(projects.size());
+
+    // Shared by the projects for decoding their sounds
+    juce::SharedResourcePointer<WorkerPool> workerPool;
+
+    {
+        juce::ThreadPool pool(std::min(jobs, static_cast<int>(projects.size())));
+
+        for (size_t i = 0; i < projects.size(); i++)
+        {
+            pool.addJob([&, i] {
+                const auto start = juce::Time::getMillisecondCounterHiRes();
+                results[i] = renderProject(projects[i], options);
+                results[i].seconds = (juce::Time::getMillisecondCounterHiRes() - start) / 1000.0;
+            });
+        }
+
+        // The pool would give up on jobs that take longer than a few seconds
+        // when it is destroyed.
+        while (pool.getNumJobs() > 0)
+        {
+            juce::Thread::sleep(50);
+        }
+    }
+
+    int failedCount = 0;
+
+    for (size_t i = 0; i < projects.size(); i++)
+    {
+        auto& result = results[i];
+        failedCount += result.rendered ? 0 : 1;
+
+        std::cout << projects[i].name << ": " << (result.rendered ? "rendered" : "failed") << " in " << result.seconds << " s"
+                  << (result.message.isEmpty() ? juce::String() : ", " + result.message.trimCharactersAtEnd("; ")) << std::endl;
+    }
+
+    return failedCount > 0 ? 1 : 0;
+}